@@ -32,4 +32,29 @@ protected:
 
 };	
 
+// Push-mode variant: nothing is called back, you hand in new state whenever you
+// have it.  To update many planes at once collect their IDs and use XPMPUpdatePlanes.
+class	XPCPushAircraft {
+public:
+
+	XPCPushAircraft(
+			const char *			inICAOCode,
+			const char *			inAirline,
+			const char *			inLivery);
+	virtual							~XPCPushAircraft();
+
+	// Any of the pointers may be NULL to keep that data as it is.
+	void							Update(
+			const XPMPPlanePosition_t *	inPosition,
+			const XPMPPlaneSurfaces_t *	inSurfaces,
+			const XPMPPlaneRadar_t *	inRadar);
+
+	XPMPPlaneID						GetPlaneID() const { return mPlane; }
+
+protected:
+
+	XPMPPlaneID			mPlane;
+
+};
+
 #endif
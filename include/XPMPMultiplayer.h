@@ -26,6 +26,8 @@
 
 #include "XPLMDefs.h"
 
+#include <stddef.h>
+
 #ifndef XPMP_CLIENT_NAME
 #define XPMP_CLIENT_NAME "A_PLUGIN"
 #endif
@@ -221,7 +223,10 @@ typedef	int			XPMPPlaneCallbackResult;
 /*
  * XPMPPlaneID
  *
- * This is a unique ID for an aircraft created by a plug-in.
+ * This is a unique ID for an aircraft created by a plug-in.  It is an opaque handle,
+ * not a pointer: once the plane is destroyed the ID is stale and every function
+ * taking it fails harmlessly (returning -1, xpmpData_Unavailable etc.), even after
+ * another plane was created.
  *
  */
 typedef	void *		XPMPPlaneID;
@@ -274,6 +279,15 @@ typedef	XPMPPlaneCallbackResult (* XPMPPlaneData_f)(
  * section	key					type	default	description
  * planes	full_distance		float	3.0
  * planes	max_full_count		int		50
+ * planes	adaptive_lod		int		0		1 = scale detail to hold lod_budget_ms
+ * planes	lod_budget_ms		float	2.0		renderer time per frame for adaptive_lod, less the data pull
+ * planes	lod_hysteresis		float	0.15	fraction of the budget that is tolerated either way
+ * planes	lod_hold_frames		int		30		frames out of the band before detail changes
+ * planes	lod_step			float	0.1		detail change per step (full detail is 1)
+ * planes	lod_min_full_count	int		10		full planes at the lowest detail
+ * planes	lod_min_full_distance_scale	float	0.25	full_distance factor at the lowest detail
+ * planes	lod_min_label_distance_scale	float	0.3	label distance factor at the lowest detail
+ * planes	lod_min_draw_distance_scale	float	0.5	draw distance factor at the lowest detail
  *
  * The return value is a string indicating any problem that may have gone wrong in a human-readable
  * form, or an empty string if initalizatoin was okay.
@@ -305,6 +319,15 @@ const char *	XPMPMultiplayerInitLegacyData(
  * section	key					type	default	description
  * planes	full_distance		float	3.0
  * planes	max_full_count		int		50
+ * planes	adaptive_lod		int		0		1 = scale detail to hold lod_budget_ms
+ * planes	lod_budget_ms		float	2.0		renderer time per frame for adaptive_lod, less the data pull
+ * planes	lod_hysteresis		float	0.15	fraction of the budget that is tolerated either way
+ * planes	lod_hold_frames		int		30		frames out of the band before detail changes
+ * planes	lod_step			float	0.1		detail change per step (full detail is 1)
+ * planes	lod_min_full_count	int		10		full planes at the lowest detail
+ * planes	lod_min_full_distance_scale	float	0.25	full_distance factor at the lowest detail
+ * planes	lod_min_label_distance_scale	float	0.3	label distance factor at the lowest detail
+ * planes	lod_min_draw_distance_scale	float	0.5	draw distance factor at the lowest detail
  * 
  * Additionally takes a string path to the resource directory of the calling plugin for storing the
  * user vertical offset config file.
@@ -320,6 +343,17 @@ const char *    XPMPMultiplayerInit(
 		float (* inFloatPrefsFunc)(const char *, const char *, float),
 		const char * resourceDir);
 
+/*
+ * XPMPReloadPrefs
+ *
+ * The library reads all the preferences it uses through the prefs funcs once at init and
+ * then keeps a snapshot; it refreshes the snapshot every "prefs_refresh_interval" seconds
+ * (section "planes", default 10, 0 turns the refresh off).  Call this after changing your
+ * ini values to have them take effect immediately.
+ *
+ */
+void			XPMPReloadPrefs(void);
+
 /*
  * XPMPMultiplayerEnable
  *
@@ -420,6 +454,8 @@ void XPMPGetModelInfo(int inIndex, const char **outModelName, const char **outIc
  * This function creates a new plane for a plug-in and returns it.  Pass in an ICAO aircraft ID code,
  * a livery string and a data function for fetching dynamic information.
  *
+ * The data function may be NULL for a plane that is fed with XPMPUpdatePlanes instead.
+ *
  */
 XPMPPlaneID	XPMPCreatePlane(
 		const char *			inICAOCode,
@@ -436,10 +472,111 @@ XPMPPlaneID	XPMPCreatePlaneWithModelName(
 		XPMPPlaneData_f			inDataFunc,
 		void *                  inRefcon);
 
+/*
+ * XPMPPlaneCreate_t
+ *
+ * One plane for XPMPCreatePlanes - the arguments of XPMPCreatePlane.
+ *
+ */
+typedef struct {
+	long							size;
+	const char *					icao;
+	const char *					airline;
+	const char *					livery;
+	XPMPPlaneData_f					dataFunc;
+	void *							refcon;
+} XPMPPlaneCreate_t;
+
+/*
+ * XPMPCreatePlanes
+ *
+ * Creates many planes at once without waiting for model matching, e.g. when a network
+ * connection brings in hundreds of targets.  outIDs receives a handle for every entry
+ * right away; the planes start out with the default ICAO's model and a match quality
+ * of -1.  The real matching runs on a background thread and its results are applied
+ * at the start of a later frame, each with an xpmp_PlaneNotification_ModelChanged.
+ * If the plane's model was changed or the plane destroyed in the meantime, the result
+ * is dropped.
+ *
+ */
+void			XPMPCreatePlanes(
+		const XPMPPlaneCreate_t *	inPlanes,
+		size_t						inCount,
+		XPMPPlaneID *				outIDs);
+
+/*
+ * XPMPPlaneUpdate_t
+ *
+ * New state for one plane, for XPMPUpdatePlanes.  Any of the data pointers may be NULL
+ * to leave that kind of data as it is.  The size fields of the data structs must be
+ * filled in as for XPMPGetPlaneData.
+ *
+ */
+typedef struct {
+	long							size;
+	XPMPPlaneID						plane;
+	const XPMPPlanePosition_t *		position;
+	const XPMPPlaneSurfaces_t *		surfaces;
+	const XPMPPlaneRadar_t *		radar;
+} XPMPPlaneUpdate_t;
+
+/*
+ * XPMPUpdatePlanes
+ *
+ * Pushes new state for any number of planes in one call.  A plane that was updated this
+ * way is push-driven from then on: the library never calls its data function again and
+ * only uses what was pushed.  Until a push-driven plane's position was pushed once it is
+ * not drawn; surfaces and radar fall back to the same defaults as for a data function
+ * returning xpmpData_Unavailable.
+ *
+ * Call this from the main thread, like every other function of this library.
+ *
+ */
+void			XPMPUpdatePlanes(
+		const XPMPPlaneUpdate_t *	inUpdates,
+		size_t						inCount);
+
+/*
+ * XPMPPlaneSnapshot_t
+ *
+ * Where a plane was at a given time.  Time is in seconds on the clock of
+ * XPLMGetElapsedTime; position and attitude are as in XPMPPlanePosition_t.
+ *
+ */
+typedef struct {
+	long		size;
+	double		time;
+	double		lat;
+	double		lon;
+	double		elevation;
+	float		pitch;
+	float		roll;
+	float		heading;
+} XPMPPlaneSnapshot_t;
+
+/*
+ * XPMPPushPlaneSnapshots
+ *
+ * Instead of handing in a position every frame, a client with a slow feed (say 1-5 Hz)
+ * can push timestamped snapshots.  The library keeps the last few per plane and every
+ * frame computes where the plane is "snapshot_delay" seconds (a pref, default 0.5) ago:
+ * smoothly interpolated between snapshots, or dead-reckoned from the last two for at
+ * most "snapshot_max_extrapolation" seconds (default 2) when the feed is late.
+ *
+ * Snapshots must be pushed in time order.  The plane becomes push-driven as with
+ * XPMPUpdatePlanes; label, colour and clamping still come from the last position
+ * pushed with XPMPUpdatePlanes (or the defaults).
+ *
+ */
+void			XPMPPushPlaneSnapshots(
+		XPMPPlaneID					inPlane,
+		const XPMPPlaneSnapshot_t *	inSnapshots,
+		size_t						inCount);
+
 /*
  * XPMPDestroyPlane
  *
- * This function deallocates a created aircraft.
+ * This function deallocates a created aircraft.  Stale IDs are ignored.
  *
  */
 void			XPMPDestroyPlane(XPMPPlaneID);
@@ -485,6 +622,116 @@ int     XPMPGetPlaneModelName(
 void	XPMPSetDefaultPlaneICAO(
 		const char *			inICAO);
 
+/************************************************************************************
+ * QUEUED PLANE API
+ ************************************************************************************/
+
+/*
+ * These functions may be called from any thread.  They don't touch any planes; they
+ * queue the call, and the library applies queued calls in order at the start of the
+ * next frame it draws.  At most "queue_commands_per_frame" calls (section "planes",
+ * default 1000, 0 = no limit) are applied per frame, the rest wait for the next one.
+ * The queue holds "queue_capacity" calls (default 4096, read by XPMPMultiplayerInit);
+ * when it is full a call is dropped and the function returns 0.
+ *
+ * All strings and data are copied, your buffers may go away right after the call.
+ * Calls made from one thread are applied in the order they were made.  Plane
+ * notifiers are called on the main thread, when the call is applied.
+ * Calls for a plane that is gone by the time they are applied are ignored.  All
+ * threads must have stopped queuing before XPMPMultiplayerCleanup.
+ *
+ */
+
+/*
+ * XPMPQueueCreatePlane
+ *
+ * Queues XPMPCreatePlane and returns the ID the plane will have, or NULL if the queue
+ * is full.  Until the xpmp_PlaneNotification_Created notification the ID may only be
+ * passed to the XPMPQueue functions.  IDs for this are set aside every frame, at most
+ * "queue_create_reserve" of them (default 256, read by XPMPMultiplayerInit) - more
+ * queued creates in one frame are dropped.
+ *
+ */
+XPMPPlaneID	XPMPQueueCreatePlane(
+		const char *			inICAOCode,
+		const char *			inAirline,
+		const char *			inLivery,
+		XPMPPlaneData_f			inDataFunc,
+		void *					inRefcon);
+
+/*
+ * XPMPQueueDestroyPlane
+ *
+ * Queues XPMPDestroyPlane.  Returns 1 if queued, 0 if dropped.
+ *
+ */
+int			XPMPQueueDestroyPlane(
+		XPMPPlaneID				inPlaneID);
+
+/*
+ * XPMPQueueChangePlaneModel
+ *
+ * Queues XPMPChangePlaneModel.  Returns 1 if queued, 0 if dropped; the match quality
+ * is available through XPMPGetPlaneModelQuality once the change was applied.
+ *
+ */
+int			XPMPQueueChangePlaneModel(
+		XPMPPlaneID				inPlaneID,
+		const char *			inICAOCode,
+		const char *			inAirline,
+		const char *			inLivery);
+
+/*
+ * XPMPQueueUpdatePlanes
+ *
+ * Queues XPMPUpdatePlanes, one queue entry per plane.  Returns the number of updates
+ * queued; the ones after it were dropped.
+ *
+ */
+size_t		XPMPQueueUpdatePlanes(
+		const XPMPPlaneUpdate_t *	inUpdates,
+		size_t						inCount);
+
+/*
+ * XPMPQueuePlaneSnapshots
+ *
+ * Queues XPMPPushPlaneSnapshots, one queue entry per snapshot.  Returns the number of
+ * snapshots queued; the ones after it were dropped.
+ *
+ */
+size_t		XPMPQueuePlaneSnapshots(
+		XPMPPlaneID					inPlane,
+		const XPMPPlaneSnapshot_t *	inSnapshots,
+		size_t						inCount);
+
+/*
+ * XPMPQueueStats_t
+ *
+ * The state of the queue.  Set size before calling XPMPGetQueueStats.  The same
+ * numbers are published as the libxplanemp/queue/depth, max_depth, dropped and
+ * applied_last_frame datarefs.
+ *
+ */
+typedef struct {
+	long		size;
+	size_t		capacity;
+	size_t		depth;				// calls waiting right now
+	size_t		maxDepth;			// most calls that were waiting at the start of a frame
+	size_t		dropped;			// calls refused because the queue was full, ever
+	size_t		applied;			// calls applied, ever
+	size_t		appliedLastFrame;
+} XPMPQueueStats_t;
+
+/*
+ * XPMPGetQueueStats
+ *
+ * Fills in the queue statistics.  May be called from any thread.  Each number is read
+ * on its own, so off the main thread they need not all be from the same frame.
+ *
+ */
+void		XPMPGetQueueStats(
+		XPMPQueueStats_t *			outStats);
+
 /************************************************************************************
  * PLANE OBSERVATION API
  ************************************************************************************/
@@ -509,12 +756,42 @@ typedef int XPMPPlaneNotification;
  * You can pass a notifier to find out when a plane is created or destroyed or other
  * data changes.
  *
+ * Notifications are collected and delivered once a frame, before the planes are drawn,
+ * not from inside the call that caused them.  Each plane gets at most one per frame: a
+ * plane created and destroyed in the same frame is never reported, a new plane whose
+ * model changed is only reported as created, a model change followed by destruction
+ * only as destroyed.  By the time xpmp_PlaneNotification_Destroyed arrives the plane is
+ * gone and its ID is stale.
+ *
  */
 typedef	void (* XPMPPlaneNotifier_f)(
 		XPMPPlaneID				inPlaneID,
 		XPMPPlaneNotification	inNotification,
 		void *					inRefcon);
 
+/*
+ * XPMPPlaneEvent_t
+ *
+ * One notification, as handed to an XPMPPlaneEventsNotifier_f.
+ *
+ */
+typedef struct {
+	XPMPPlaneID				plane;
+	XPMPPlaneNotification	notification;
+} XPMPPlaneEvent_t;
+
+/*
+ * XPMPPlaneEventsNotifier_f
+ *
+ * Like XPMPPlaneNotifier_f, but gets all of a frame's notifications in one call, in the
+ * order they happened.  The array is only valid during the call.
+ *
+ */
+typedef	void (* XPMPPlaneEventsNotifier_f)(
+		const XPMPPlaneEvent_t *	inEvents,
+		size_t						inCount,
+		void *						inRefcon);
+
 /*
  * XPMPCountPlanes
  *
@@ -526,7 +803,8 @@ long			XPMPCountPlanes(void);
 /*
  * XPMPGetNthPlane
  *
- * This function returns the plane ID of the Nth plane.
+ * This function returns the plane ID of the Nth plane.  Destroying a plane moves the
+ * last plane into its index.
  *
  */
 XPMPPlaneID	XPMPGetNthPlane(
@@ -565,6 +843,26 @@ void			XPMPUnregisterPlaneNotifierFunc(
 		XPMPPlaneNotifier_f		inFunc,
 		void *					inRefcon);
 
+/*
+ * XPMPRegisterPlaneEventsFunc
+ *
+ * This function registers a notifier that gets each frame's notifications in one batch.
+ *
+ */
+void			XPMPRegisterPlaneEventsFunc(
+		XPMPPlaneEventsNotifier_f	inFunc,
+		void *						inRefcon);
+
+/*
+ * XPMPUnregisterPlaneEventsFunc
+ *
+ * This function cancels a registration made with XPMPRegisterPlaneEventsFunc.
+ *
+ */
+void			XPMPUnregisterPlaneEventsFunc(
+		XPMPPlaneEventsNotifier_f	inFunc,
+		void *						inRefcon);
+
 /*
  * XPMPGetPlaneData
  *
@@ -612,6 +910,31 @@ int			XPMPModelMatchQuality(
 		const char *				inAirline,
 		const char *				inLivery);
 
+/*
+ * XPMPMatchCacheStats_t
+ *
+ * Model matching remembers the last "match_cache_size" (a pref, default 4096, 0 turns it
+ * off) ICAO/airline/livery combinations it was asked for.  Loading packages, changing
+ * the default ICAO and enabling the library start it over.  Fill in size before calling.
+ *
+ */
+typedef struct {
+	long		size;
+	size_t		entries;
+	size_t		capacity;
+	size_t		hits;				// ever
+	size_t		misses;				// ever
+} XPMPMatchCacheStats_t;
+
+/*
+ * XPMPGetMatchCacheStats
+ *
+ * Fills in the match cache statistics.
+ *
+ */
+void		XPMPGetMatchCacheStats(
+		XPMPMatchCacheStats_t *		outStats);
+
 /************************************************************************************
  * PLANE RENDERING API
  ************************************************************************************/
@@ -661,6 +984,132 @@ void				  XPMPDisableAircraftLabels(void);
 
 bool				  XPMPDrawingAircraftLabels(void);
 
+/*
+ * XPMPInvalidateTerrainCache
+ *
+ * Ground clamping caches terrain heights.  X-Plane shifting its local coordinate system
+ * is detected automatically, but the library can't see scenery being reloaded - call this
+ * when your plugin receives XPLM_MSG_SCENERY_LOADED.
+ *
+ */
+void				  XPMPInvalidateTerrainCache(void);
+
+/*
+ * XPMPGetTerrainCacheStats
+ *
+ * Returns the terrain cache counters since startup: lookups answered from the plane's own
+ * last probe, lookups answered by the cell cache, real terrain probes and lookups deferred
+ * because the per-frame probe budget was used up.  Any pointer may be NULL.  Use these to
+ * tune the "terrain_cell_size", "terrain_motion_threshold" and "terrain_probes_per_frame"
+ * prefs in the "planes" section.
+ *
+ */
+void				  XPMPGetTerrainCacheStats(
+		long *						outPlaneHits,
+		long *						outCellHits,
+		long *						outMisses,
+		long *						outDeferred);
+
+/*
+ * XPMPGetTcasSlotCount
+ *
+ * Returns the number of sim/multiplayer/position/planeN slots available to show our
+ * planes on TCAS.  Slot n uses the datarefs of plane n+1.
+ *
+ */
+int					  XPMPGetTcasSlotCount(void);
+
+/*
+ * XPMPGetPlaneInTcasSlot
+ *
+ * Returns the plane currently shown in the given TCAS slot, or NULL if the slot is
+ * free.  A plane keeps its slot as long as it stays on TCAS, so plugins following
+ * the multiplayer datarefs can rely on this mapping from frame to frame.
+ *
+ */
+XPMPPlaneID			  XPMPGetPlaneInTcasSlot(int inSlot);
+
+/*
+ * XPMPGetTcasSlotOfPlane
+ *
+ * Returns the TCAS slot of a plane, or -1 if it isn't shown on TCAS right now.
+ *
+ */
+int					  XPMPGetTcasSlotOfPlane(XPMPPlaneID inPlane);
+
+/************************************************************************************
+ * RENDERER STATISTICS
+ ************************************************************************************/
+
+/*
+ * XPMPRenderStage
+ *
+ * The stages of the default renderer that are timed.  Data pull is the time spent in
+ * your XPMPPlaneData_f callbacks; everything else is the library.  Terrain probe is
+ * part of vertical offset, and everything is part of total.
+ *
+ */
+enum {
+	xpmpStage_DataPull			= 0,
+	xpmpStage_WorldToLocal		= 1,
+	xpmpStage_Cull				= 2,
+	xpmpStage_VertOffset		= 3,
+	xpmpStage_TerrainProbe		= 4,
+	xpmpStage_TCAS				= 5,
+	xpmpStage_DrawNoModel		= 6,
+	xpmpStage_DrawAustin		= 7,
+	xpmpStage_DrawObj7			= 8,
+	xpmpStage_DrawObj8			= 9,
+	xpmpStage_DrawLights		= 10,
+	xpmpStage_Labels			= 11,
+	xpmpStage_MaintainTextures	= 12,
+	xpmpStage_Total				= 13,
+	xpmpStage_Count				= 14
+};
+typedef int XPMPRenderStage;
+
+/*
+ * XPMPRenderStageStats_t
+ *
+ * Time spent in one stage per frame, in microseconds, over the last frames
+ * (XPMPRenderStats_t::frames of them).
+ *
+ */
+typedef struct {
+	float	minUs;
+	float	meanUs;
+	float	p99Us;
+	float	lastUs;
+} XPMPRenderStageStats_t;
+
+/*
+ * XPMPRenderStats_t
+ *
+ * What the default renderer did in the last frame and how long it took.  Set size
+ * before calling XPMPGetRenderStats.
+ *
+ */
+typedef struct {
+	long					size;
+	int						planes;			// planes we know of
+	int						acfPlanes;		// Austin's planes drawn in full
+	int						navPlanes;		// Austin's planes drawn with lights only
+	int						objPlanes;		// OBJ7 planes drawn
+	int						frames;			// frames the timings are taken over
+	XPMPRenderStageStats_t	stages[xpmpStage_Count];
+	float					lodLevel;		// adaptive detail level, 1 = as configured, 0 = the "lod_min_*" prefs
+} XPMPRenderStats_t;
+
+/*
+ * XPMPGetRenderStats
+ *
+ * Fills in the renderer statistics.  The same numbers are published as
+ * libxplanemp/stats/<stage>_min_us, _mean_us and _p99_us datarefs.
+ *
+ */
+void				  XPMPGetRenderStats(
+		XPMPRenderStats_t *			outStats);
+
 #ifdef __cplusplus
 }
 #endif
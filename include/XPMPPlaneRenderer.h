@@ -33,4 +33,13 @@ void			XPMPDefaultPlaneRenderer(int is_blend);
 void			XPMPDeinitDefaultPlaneRenderer(void);
 void            XPMPInitMultiplayerDataRefs(void);
 
+// The default renderer builds its plan (positions, state, TCAS) once per frame and
+// reuses it for every pass.  Call this when planes come or go mid-frame so it
+// doesn't hold on to stale planes.
+void			XPMPInvalidateRenderPlan(void);
+
+// Frees the TCAS slot held by a plane - must be called before the plane goes away.
+struct XPMPPlane_t;
+void			XPMPReleaseTcasSlot(XPMPPlane_t * inPlane);
+
 #endif
\ No newline at end of file
@@ -25,27 +25,27 @@
 
 /* Interpolation Utilities.  These are defined inline in the hope of speed. */
 
-double	clamp(double v, double min, double max);
+inline double	clamp(double v, double min, double max);
 
-double	BilinearInterpolate1d(
+inline double	BilinearInterpolate1d(
 		double		v0,
 		double		v1,
 		double		position);
 
-double	BilinearInterpolate2d(
+inline double	BilinearInterpolate2d(
 		double		v0,	double	v1,
 		double		v2, double	v3,
 		double		hPosition,
 		double		vPosition);
 
-double	BicubicInterpolate1d(
+inline double	BicubicInterpolate1d(
 		double		v0,
 		double		v1,
 		double		v2,
 		double		v3,
 		double		position);
 
-double	BicubicInterpolate2d(
+inline double	BicubicInterpolate2d(
 		double		v0,		double	v1,		double	v2,		double	v3,
 		double		v4,		double	v5,		double	v6,		double	v7,
 		double		v8,		double	v9,		double	v10,	double	v11,
@@ -53,6 +53,17 @@ double	BicubicInterpolate2d(
 		double		hPosition,
 		double		vPosition);
 
+inline double	HermiteInterpolate1d(
+		double		v0,
+		double		v1,
+		double		v2,
+		double		v3,
+		double		t0,
+		double		t1,
+		double		t2,
+		double		t3,
+		double		t);
+
 #include "Interpolation.i"
 
 #endif
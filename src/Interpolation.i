@@ -24,7 +24,7 @@
 
 /* Interpolation inlines... */
 
-double	clamp(double v, double min, double max)
+inline double	clamp(double v, double min, double max)
 {
 	return (v < min) ? min : ((v > max) ? max : v);
 }
@@ -33,7 +33,7 @@ double	clamp(double v, double min, double max)
 	v0 is the value at point 0, v1 is the value at point 1, and position is a 
 	fractional position between the two. */
 
-double	BilinearInterpolate1d(
+inline double	BilinearInterpolate1d(
 					double		v0,
 					double		v1,
 					double		position)
@@ -48,7 +48,7 @@ double	BilinearInterpolate1d(
 	in two dimensions with hPosition and vPosition being fractions specifying 
 	where in the square we want to interpolate. */
 					
-double	BilinearInterpolate2d(
+inline double	BilinearInterpolate2d(
 					double		v0,	double	v1,
 					double		v2, double	v3,
 					double		hPosition,
@@ -65,7 +65,7 @@ double	BilinearInterpolate2d(
 	But we take advantage of the extra data to provide more accuracy in
 	our interpolation. */
 					
-double	BicubicInterpolate1d(
+inline double	BicubicInterpolate1d(
 					double		v0,
 					double		v1,
 					double		v2,
@@ -96,7 +96,7 @@ double	BicubicInterpolate1d(
 
 }					
 					
-double	BicubicInterpolate2d(
+inline double	BicubicInterpolate2d(
 					double	v0,		double	v1,		double	v2,		double	v3,
 					double	v4,		double	v5,		double	v6,		double	v7,
 					double	v8,		double	v9,		double	v10,	double	v11,
@@ -111,3 +111,34 @@ double	BicubicInterpolate2d(
 		BicubicInterpolate1d(v12, v13, v14, v15, hPosition),
 		vPosition);
 }					
+
+/*	Cubic Hermite interpolation for samples that are not evenly spaced, e.g. in time.
+	We take four values v0-v3 at t0-t3 (t0 < t1 < t2 < t3) and interpolate between
+	v1 and v2 at t.  The slopes at t1 and t2 come from the neighbours, Catmull-Rom style,
+	so the curve passes through every sample and is smooth across them.  Unlike the
+	bicubic version above the result is not clamped. */
+
+inline double	HermiteInterpolate1d(
+					double		v0,
+					double		v1,
+					double		v2,
+					double		v3,
+					double		t0,
+					double		t1,
+					double		t2,
+					double		t3,
+					double		t)
+{
+	double	h = t2 - t1;
+	if (h <= 0.0)
+		return v1;
+	double	m1 = (t2 > t0) ? (v2 - v0) / (t2 - t0) * h : v2 - v1;
+	double	m2 = (t3 > t1) ? (v3 - v1) / (t3 - t1) * h : v2 - v1;
+	double	s = (t - t1) / h;
+	double	s2 = s * s;
+	double	s3 = s2 * s;
+	return	(2.0 * s3 - 3.0 * s2 + 1.0) * v1 +
+			(s3 - 2.0 * s2 + s) * m1 +
+			(-2.0 * s3 + 3.0 * s2) * v2 +
+			(s3 - s2) * m2;
+}
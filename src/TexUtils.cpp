@@ -305,7 +305,7 @@ static XPLMDataRef sAnisotropicLevel = nullptr;
 
 bool LoadTextureFromMemory(ImageInfo &im, bool magentaAlpha, bool inWrap, bool mipmap, GLuint &texNum)
 {
-	float	tex_anisotropyLevel = gFloatPrefsFunc("planes", "texture_anisotropy", 0.0);
+	float	tex_anisotropyLevel = gPrefs.texture_anisotropy;
 	if (sAnisotropicLevel == nullptr) {
 		sAnisotropicLevel = XPLMFindDataRef("sim/private/controls/reno/aniso_filter");
 	}
@@ -32,3 +32,30 @@ XPMPPlaneCallbackResult	XPCAircraft::AircraftCB(
 		return xpmpData_Unavailable;
 	}
 }
+
+XPCPushAircraft::XPCPushAircraft(
+		const char *			inICAOCode,
+		const char *			inAirline,
+		const char *			inLivery)
+{
+	mPlane = XPMPCreatePlane(inICAOCode, inAirline, inLivery, NULL, NULL);
+}
+
+XPCPushAircraft::~XPCPushAircraft()
+{
+	XPMPDestroyPlane(mPlane);
+}
+
+void	XPCPushAircraft::Update(
+		const XPMPPlanePosition_t *	inPosition,
+		const XPMPPlaneSurfaces_t *	inSurfaces,
+		const XPMPPlaneRadar_t *	inRadar)
+{
+	XPMPPlaneUpdate_t update;
+	update.size = sizeof(update);
+	update.plane = mPlane;
+	update.position = inPosition;
+	update.surfaces = inSurfaces;
+	update.radar = inRadar;
+	XPMPUpdatePlanes(&update, 1);
+}
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "XPMPAtomTable.h"
+
+#include <string.h>
+
+AtomTable		gCSLAtoms;
+
+bool AtomTable::Ref_t::operator==(const Ref_t& inOther) const
+{
+	return len == inOther.len && memcmp(text, inOther.text, len) == 0;
+}
+
+size_t AtomTable::RefHash::operator()(const Ref_t& inRef) const
+{
+	// FNV-1a
+	uint64_t h = 14695981039346656037ULL;
+	for (size_t n = 0; n < inRef.len; ++n)
+	{
+		h ^= static_cast<unsigned char>(inRef.text[n]);
+		h *= 1099511628211ULL;
+	}
+	return static_cast<size_t>(h);
+}
+
+AtomTable::AtomTable()
+{
+	mAtoms.push_back("");
+	mIndex.emplace(Ref_t{ mAtoms[0], 0 }, 0);
+}
+
+const char * AtomTable::store(const char * inText, size_t inLen)
+{
+	char * dst;
+	if (inLen + 1 > kChunkSize / 4)
+	{
+		// big ones get their own chunk - in front of the one we're filling, so we keep filling it
+		auto where = mChunks.empty() ? mChunks.end() : mChunks.end() - 1;
+		dst = mChunks.insert(where, std::unique_ptr<char[]>(new char[inLen + 1]))->get();
+		mBytes += inLen + 1;
+	}
+	else
+	{
+		if (mChunkUsed + inLen + 1 > kChunkSize)
+		{
+			mChunks.emplace_back(new char[kChunkSize]);
+			mChunkUsed = 0;
+			mBytes += kChunkSize;
+		}
+		dst = mChunks.back().get() + mChunkUsed;
+		mChunkUsed += inLen + 1;
+	}
+	memcpy(dst, inText, inLen);
+	dst[inLen] = 0;
+	return dst;
+}
+
+CSLAtom_t AtomTable::intern(const std::string& inText)
+{
+	std::lock_guard<std::mutex> lock(mInternLock);
+	auto i = mIndex.find(Ref_t{ inText.c_str(), inText.size() });
+	if (i != mIndex.end())
+		return atom(i->second);
+
+	if (mAtoms.size() >= kMaxAtoms)
+	{
+		++mDropped;
+		return CSLAtom_t();
+	}
+	const char * text = store(inText.c_str(), inText.size());
+	const uint32_t id = static_cast<uint32_t>(mAtoms.size());
+	mAtoms.push_back(text);
+	mIndex.emplace(Ref_t{ text, inText.size() }, id);
+	return atom(id);
+}
+
+bool AtomTable::find(const char * inText, CSLAtom_t& outAtom) const
+{
+	auto i = mIndex.find(Ref_t{ inText, strlen(inText) });
+	if (i == mIndex.end())
+		return false;
+	outAtom = atom(i->second);
+	return true;
+}
+
+CSLAtom_t AtomTable::atom(uint32_t inID) const
+{
+	CSLAtom_t a;
+	if (inID < mAtoms.size())
+	{
+		a.id = inID;
+		a.text = mAtoms[inID];
+	}
+	return a;
+}
+
+std::string CSL_MatchKeyString(CSLMatchKey inKey)
+{
+	std::string s;
+	for (int part = 0; part < 3; ++part)
+	{
+		CSLAtom_t a = CSL_MatchKeyPart(inKey, part);
+		if (a.empty())
+			continue;
+		if (!s.empty())
+			s += ' ';
+		s += a.text;
+	}
+	return s;
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef XPMPATOMTABLE_H
+#define XPMPATOMTABLE_H
+
+/*
+ * XPMPAtomTable
+ *
+ * The CSL catalog repeats the same few strings tens of thousands of times - ICAO codes,
+ * airlines, liveries, directory and texture names.  Each distinct string is stored once
+ * in an arena and known by a small integer, its atom.  Models hold atoms instead of
+ * strings, and the match keys are atoms packed into one 64 bit integer (see
+ * CSL_MatchKey), so the match maps compare integers.
+ *
+ * Strings only ever get added, when loading packages under an exclusive gCSLIndexLock;
+ * looking up is fine under a shared one.  The loader's parse workers may intern at the
+ * same time, so intern locks; find and atom don't.  An atom's text never moves.
+ *
+ */
+
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct CSLAtom_t {
+	uint32_t			id = 0;				// 0 is always ""
+	const char *		text = "";
+
+	const char *	c_str() const { return text; }
+	std::string		str() const { return text; }
+	bool			empty() const { return id == 0; }
+
+	bool operator==(const CSLAtom_t& inOther) const { return id == inOther.id; }
+	bool operator!=(const CSLAtom_t& inOther) const { return id != inOther.id; }
+};
+
+class AtomTable {
+
+public:
+	// Atoms must fit the 21 bit fields of a match key.
+	enum { kMaxAtoms = 1 << 21 };
+
+	AtomTable();
+
+	// Once the table is full this gives the empty atom; dropped() counts those.
+	CSLAtom_t		intern(const std::string& inText);
+
+	// Doesn't add - false if nobody interned inText yet.
+	bool			find(const char * inText, CSLAtom_t& outAtom) const;
+
+	CSLAtom_t		atom(uint32_t inID) const;
+
+	size_t			size() const { return mAtoms.size(); }
+	size_t			bytes() const { return mBytes; }
+	size_t			dropped() const { return mDropped; }
+
+private:
+	enum { kChunkSize = 64 * 1024 };
+
+	struct Ref_t {
+		const char *	text;
+		size_t			len;
+		bool operator==(const Ref_t& inOther) const;
+	};
+	struct RefHash {
+		size_t operator()(const Ref_t& inRef) const;
+	};
+
+	const char *	store(const char * inText, size_t inLen);
+
+	std::vector<std::unique_ptr<char[]>>		mChunks;
+	size_t										mChunkUsed = kChunkSize;
+	size_t										mBytes = 0;
+	size_t										mDropped = 0;
+	std::vector<const char *>					mAtoms;		// by id
+	std::unordered_map<Ref_t, uint32_t, RefHash>	mIndex;
+	std::mutex									mInternLock;
+};
+
+extern AtomTable		gCSLAtoms;
+
+// A match key - up to three atoms, e.g. ICAO, airline and livery.
+typedef uint64_t		CSLMatchKey;
+
+inline CSLMatchKey	CSL_MatchKey(const CSLAtom_t& inA, const CSLAtom_t& inB = CSLAtom_t(), const CSLAtom_t& inC = CSLAtom_t())
+{
+	return (static_cast<uint64_t>(inA.id) << 42) | (static_cast<uint64_t>(inB.id) << 21) | inC.id;
+}
+
+inline CSLAtom_t	CSL_MatchKeyPart(CSLMatchKey inKey, int inPart)
+{
+	return gCSLAtoms.atom(static_cast<uint32_t>(inKey >> (42 - 21 * inPart)) & (AtomTable::kMaxAtoms - 1));
+}
+
+// "B738 SWA" - for diagnostics.
+std::string			CSL_MatchKeyString(CSLMatchKey inKey);
+
+#endif /* XPMPATOMTABLE_H */
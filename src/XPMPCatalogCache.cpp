@@ -0,0 +1,445 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "XPMPCatalogCache.h"
+
+#include <fstream>
+#include <set>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+CSLFileStamp_t CSL_StampFile(const std::string& inPath)
+{
+	CSLFileStamp_t stamp;
+	stamp.path = inPath;
+#if IBM
+	struct _stat64 st;
+	if (_stat64(inPath.c_str(), &st) == 0)
+#else
+	struct stat st;
+	if (stat(inPath.c_str(), &st) == 0)
+#endif
+	{
+		stamp.mtime = static_cast<int64_t>(st.st_mtime);
+		stamp.size = static_cast<int64_t>(st.st_size);
+	}
+	return stamp;
+}
+
+namespace {
+
+const char		kMagic[8] = { 'X', 'P', 'M', 'P', 'C', 'S', 'L', 'C' };
+const uint32_t	kByteOrder = 0x01020304;
+
+// Builds the body while collecting its strings; the string table goes in front.
+class Writer {
+public:
+	void	u8(uint8_t inValue)		{ raw(&inValue, sizeof(inValue)); }
+	void	u32(uint32_t inValue)	{ raw(&inValue, sizeof(inValue)); }
+	void	i32(int32_t inValue)	{ raw(&inValue, sizeof(inValue)); }
+	void	i64(int64_t inValue)	{ raw(&inValue, sizeof(inValue)); }
+	void	f64(double inValue)		{ raw(&inValue, sizeof(inValue)); }
+
+	// by reference into the string table
+	void	str(const std::string& inText)
+	{
+		auto i = mPool.emplace(inText, static_cast<uint32_t>(mStrings.size()));
+		if (i.second)
+			mStrings.push_back(&i.first->first);
+		u32(i.first->second);
+	}
+	void	atom(const CSLAtom_t& inAtom)	{ str(inAtom.str()); }
+
+	// inline, for text that isn't worth sharing
+	void	blob(const std::string& inText)
+	{
+		u32(static_cast<uint32_t>(inText.size()));
+		mBody.append(inText);
+	}
+
+	void	stamp(const CSLFileStamp_t& inStamp)
+	{
+		str(inStamp.path);
+		i64(inStamp.mtime);
+		i64(inStamp.size);
+	}
+
+	std::string	finish() const
+	{
+		Writer out;
+		out.raw(kMagic, sizeof(kMagic));
+		out.u32(CSLCatalogCache::kVersion);
+		out.u32(kByteOrder);
+		out.u32(static_cast<uint32_t>(mStrings.size()));
+		for (const std::string * s : mStrings)
+			out.blob(*s);
+		out.mBody.append(mBody);
+		return out.mBody;
+	}
+
+private:
+	void	raw(const void * inData, size_t inLen)	{ mBody.append(static_cast<const char *>(inData), inLen); }
+
+	std::string								mBody;
+	std::map<std::string, uint32_t>		mPool;
+	std::vector<const std::string *>		mStrings;
+};
+
+// Reads what Writer wrote.  Never runs past the end - once anything is off, ok() is false
+// and everything reads as 0.
+class Reader {
+public:
+	Reader(const char * inData, size_t inLen) : mPos(inData), mEnd(inData + inLen) { }
+
+	bool		ok() const { return mOk; }
+
+	uint8_t		u8()	{ uint8_t v = 0; raw(&v, sizeof(v)); return v; }
+	uint32_t	u32()	{ uint32_t v = 0; raw(&v, sizeof(v)); return v; }
+	int32_t		i32()	{ int32_t v = 0; raw(&v, sizeof(v)); return v; }
+	int64_t		i64()	{ int64_t v = 0; raw(&v, sizeof(v)); return v; }
+	double		f64()	{ double v = 0; raw(&v, sizeof(v)); return v; }
+
+	// an element count - every element takes at least a byte, so more than is left is bad
+	uint32_t	count()
+	{
+		const uint32_t n = u32();
+		if (n > static_cast<size_t>(mEnd - mPos))
+			fail();
+		return mOk ? n : 0;
+	}
+
+	bool		header()
+	{
+		char magic[sizeof(kMagic)];
+		raw(magic, sizeof(magic));
+		if (!mOk || memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+			u32() != CSLCatalogCache::kVersion || u32() != kByteOrder)
+			return fail();
+		const uint32_t n = count();
+		mAtoms.reserve(n);
+		for (uint32_t i = 0; i < n && mOk; ++i)
+			mAtoms.push_back(gCSLAtoms.intern(blob()));
+		return mOk;
+	}
+
+	CSLAtom_t	atom()
+	{
+		const uint32_t i = u32();
+		if (i >= mAtoms.size())
+		{
+			fail();
+			return CSLAtom_t();
+		}
+		return mAtoms[i];
+	}
+	std::string	str()	{ return atom().str(); }
+
+	std::string	blob()
+	{
+		const uint32_t n = count();
+		std::string text(mPos, mOk ? n : 0);
+		mPos += text.size();
+		return text;
+	}
+
+	CSLFileStamp_t	stamp()
+	{
+		CSLFileStamp_t s;
+		s.path = str();
+		s.mtime = i64();
+		s.size = i64();
+		return s;
+	}
+
+private:
+	bool		fail() { mOk = false; mPos = mEnd; return false; }
+
+	void		raw(void * outData, size_t inLen)
+	{
+		if (static_cast<size_t>(mEnd - mPos) < inLen)
+		{
+			fail();
+			return;
+		}
+		memcpy(outData, mPos, inLen);
+		mPos += inLen;
+	}
+
+	const char *				mPos;
+	const char *				mEnd;
+	bool						mOk = true;
+	std::vector<CSLAtom_t>		mAtoms;		// the string table
+};
+
+void	WritePlane(Writer& out, const CSLPlane_t& inPlane)
+{
+	out.u32(static_cast<uint32_t>(inPlane.dirNames.size()));
+	for (const CSLAtom_t& dir : inPlane.dirNames)
+		out.atom(dir);
+	out.atom(inPlane.objectName);
+	out.atom(inPlane.textureName);
+	out.atom(inPlane.icao);
+	out.atom(inPlane.airline);
+	out.atom(inPlane.livery);
+	out.i32(inPlane.plane_type);
+	out.atom(inPlane.file_path);
+	out.atom(inPlane.texturePath);
+	out.atom(inPlane.textureLitPath);
+	out.u8(inPlane.moving_gear);
+	out.i32(inPlane.austin_idx);
+	out.i32(inPlane.obj_idx);
+	out.i32(inPlane.texID);
+	out.i32(inPlane.texLitID);
+	out.u32(static_cast<uint32_t>(inPlane.attachments.size()));
+	for (const obj_for_acf& att : inPlane.attachments)
+	{
+		out.str(att.file);
+		out.i32(att.draw_type);
+		out.u8(att.needs_animation);
+	}
+	out.u8(inPlane.isXsbVertOffsetAvail);
+	out.f64(inPlane.xsbVertOffset);
+}
+
+void	ReadPlane(Reader& in, CSLPlane_t& outPlane)
+{
+	outPlane.dirNames.resize(in.count());
+	for (CSLAtom_t& dir : outPlane.dirNames)
+		dir = in.atom();
+	outPlane.objectName = in.atom();
+	outPlane.textureName = in.atom();
+	outPlane.icao = in.atom();
+	outPlane.airline = in.atom();
+	outPlane.livery = in.atom();
+	outPlane.plane_type = in.i32();
+	outPlane.file_path = in.atom();
+	outPlane.texturePath = in.atom();
+	outPlane.textureLitPath = in.atom();
+	outPlane.moving_gear = in.u8() != 0;
+	outPlane.austin_idx = in.i32();
+	outPlane.obj_idx = in.i32();
+	outPlane.texID = in.i32();
+	outPlane.texLitID = in.i32();
+	outPlane.attachments.resize(in.count());
+	for (obj_for_acf& att : outPlane.attachments)
+	{
+		att.file = in.str();
+		att.draw_type = static_cast<obj_draw_type>(in.i32());
+		att.needs_animation = in.u8() != 0;
+		att.load_state = load_none;
+		att.handle = NULL;
+	}
+	outPlane.isXsbVertOffsetAvail = in.u8() != 0;
+	outPlane.xsbVertOffset = in.f64();
+}
+
+}	// namespace
+
+bool CSLCatalogCache::read(const std::string& inFile)
+{
+	*this = CSLCatalogCache();
+
+	std::ifstream fi(inFile, std::ios::in | std::ios::binary);
+	if (!fi)
+		return false;
+	const std::string data((std::istreambuf_iterator<char>(fi)), std::istreambuf_iterator<char>());
+
+	Reader in(data.data(), data.size());
+	if (!in.header())
+		return false;
+
+	simVersion = in.i32();
+	systemPath = in.str();
+
+	related = in.stamp();
+	groupings.resize(in.count());
+	for (auto& g : groupings)
+	{
+		g.first = in.atom();
+		g.second = in.atom();
+	}
+
+	doc8643 = in.stamp();
+	codes.resize(in.count());
+	for (CSLAircraftCode_t& code : codes)
+	{
+		code.icao = in.str();
+		code.equip = in.str();
+		code.category = static_cast<char>(in.u8());
+	}
+
+	headers.resize(in.count());
+	for (auto& h : headers)
+	{
+		h.first = in.str();
+		h.second = in.str();
+	}
+
+	packages.resize(in.count());
+	for (Package_t& p : packages)
+	{
+		p.deps.resize(in.count());
+		for (CSLFileStamp_t& dep : p.deps)
+			dep = in.stamp();
+		p.package.name = in.str();
+		p.package.path = in.str();
+		p.package.planes.resize(in.count());
+		for (CSLPlane_t& plane : p.package.planes)
+			ReadPlane(in, plane);
+		for (auto& matches : p.package.matches)
+		{
+			for (uint32_t n = in.count(); n > 0 && in.ok(); --n)
+			{
+				const CSLAtom_t a = in.atom(), b = in.atom(), c = in.atom();
+				const int32_t index = in.i32();
+				if (index < 0 || static_cast<size_t>(index) >= p.package.planes.size())
+					return discard();
+				matches.emplace(CSL_MatchKey(a, b, c), index);
+			}
+		}
+		p.log = in.blob();
+		if (p.deps.empty())
+			return discard();
+	}
+
+	if (!in.ok())
+		return discard();
+
+	for (size_t n = 0; n < packages.size(); ++n)
+		mByPath[packages[n].package.path] = n;
+	return true;
+}
+
+bool CSLCatalogCache::write(const std::string& inFile) const
+{
+	Writer out;
+	out.i32(simVersion);
+	out.str(systemPath);
+
+	out.stamp(related);
+	out.u32(static_cast<uint32_t>(groupings.size()));
+	for (const auto& g : groupings)
+	{
+		out.atom(g.first);
+		out.atom(g.second);
+	}
+
+	out.stamp(doc8643);
+	out.u32(static_cast<uint32_t>(codes.size()));
+	for (const CSLAircraftCode_t& code : codes)
+	{
+		out.str(code.icao);
+		out.str(code.equip);
+		out.u8(static_cast<uint8_t>(code.category));
+	}
+
+	out.u32(static_cast<uint32_t>(headers.size()));
+	for (const auto& h : headers)
+	{
+		out.str(h.first);
+		out.str(h.second);
+	}
+
+	out.u32(static_cast<uint32_t>(packages.size()));
+	for (const Package_t& p : packages)
+	{
+		out.u32(static_cast<uint32_t>(p.deps.size()));
+		for (const CSLFileStamp_t& dep : p.deps)
+			out.stamp(dep);
+		out.str(p.package.name);
+		out.str(p.package.path);
+		out.u32(static_cast<uint32_t>(p.package.planes.size()));
+		for (const CSLPlane_t& plane : p.package.planes)
+			WritePlane(out, plane);
+		for (const auto& matches : p.package.matches)
+		{
+			out.u32(static_cast<uint32_t>(matches.size()));
+			for (const auto& m : matches)
+			{
+				out.atom(CSL_MatchKeyPart(m.first, 0));
+				out.atom(CSL_MatchKeyPart(m.first, 1));
+				out.atom(CSL_MatchKeyPart(m.first, 2));
+				out.i32(m.second);
+			}
+		}
+		out.blob(p.log);
+	}
+
+	// write aside and swap in, so a crash never leaves half a cache behind
+	const std::string data = out.finish();
+	const std::string tmpFile = inFile + ".tmp";
+	{
+		std::ofstream fo(tmpFile, std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!fo)
+			return false;
+		fo.write(data.data(), static_cast<std::streamsize>(data.size()));
+		if (!fo)
+		{
+			fo.close();
+			remove(tmpFile.c_str());
+			return false;
+		}
+	}
+	remove(inFile.c_str());
+	return rename(tmpFile.c_str(), inFile.c_str()) == 0;
+}
+
+const CSLCatalogCache::Package_t * CSLCatalogCache::findValid(const std::string& inPath) const
+{
+	auto i = mByPath.find(inPath);
+	if (i == mByPath.end())
+		return nullptr;
+	const Package_t& p = packages[i->second];
+	for (const CSLFileStamp_t& dep : p.deps)
+	{
+		if (CSL_StampFile(dep.path) != dep)
+			return nullptr;
+	}
+	return &p;
+}
+
+void CSLCatalogCache::collectDeps(const CSLPackage_t& inPackage, const std::string& inPackageFile, std::vector<CSLFileStamp_t>& outDeps)
+{
+	outDeps.clear();
+	outDeps.push_back(CSL_StampFile(inPackageFile));
+
+	std::set<std::string> files;
+	for (const CSLPlane_t& plane : inPackage.planes)
+	{
+		// the OBJ7 header names the default texture
+		if (plane.plane_type == plane_Obj)
+			files.insert(plane.file_path.str());
+		// the lit texture is whichever exists next to it
+		if (!plane.texturePath.empty())
+		{
+			const std::string texturePath = plane.texturePath.str();
+			const size_t sep = texturePath.find_last_of("/\\");
+			if (sep != std::string::npos)
+				files.insert(texturePath.substr(0, sep));
+		}
+	}
+	for (const std::string& file : files)
+		outDeps.push_back(CSL_StampFile(file));
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef XPMPCATALOGCACHE_H
+#define XPMPCATALOGCACHE_H
+
+/*
+ * XPMPCatalogCache
+ *
+ * Parsing a large CSL library means tokenizing every xsb_aircraft.txt, opening every OBJ7
+ * header for its texture and probing for every lit texture.  What comes out of that is
+ * written to a binary file in the CSL folder, so the next start can take it as is.
+ *
+ * A cached package is only used while every file its parse looked at is unchanged (mtime
+ * and size): its xsb_aircraft.txt, its OBJ7 files and the folders its textures are in
+ * (a lit texture appearing or going away touches the folder).  Since a package resolves
+ * its paths through the other packages' names and related.txt feeds its match keys, the
+ * whole set of cached packages is dropped if the package list, related.txt or the sim
+ * changed.  Anything not taken from the cache is parsed as usual.
+ *
+ * The file is flat - a string table and records referring to it - and is read in one go.
+ * Bump kVersion whenever the layout or what the parser produces changes.
+ *
+ */
+
+#include "XPMPMultiplayerVars.h"
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A file's mtime and size, -1 if it isn't there.
+struct CSLFileStamp_t {
+	std::string		path;
+	int64_t			mtime = -1;
+	int64_t			size = -1;
+
+	bool operator==(const CSLFileStamp_t& inOther) const
+	{
+		return mtime == inOther.mtime && size == inOther.size && path == inOther.path;
+	}
+	bool operator!=(const CSLFileStamp_t& inOther) const { return !(*this == inOther); }
+};
+
+CSLFileStamp_t		CSL_StampFile(const std::string& inPath);
+
+class CSLCatalogCache {
+
+public:
+	enum { kVersion = 1 };
+
+	struct Package_t {
+		std::vector<CSLFileStamp_t>		deps;		// deps[0] is the package's xsb_aircraft.txt
+		CSLPackage_t					package;	// as parsed, before modelName is set
+		std::string						log;		// parse diagnostics, logged again when used
+	};
+
+	// What the catalog was parsed against.
+	int											simVersion = 0;
+	std::string									systemPath;
+	CSLFileStamp_t								related;
+	std::vector<std::pair<CSLAtom_t, CSLAtom_t>>	groupings;	// related.txt - ICAO, group
+	CSLFileStamp_t								doc8643;
+	std::vector<CSLAircraftCode_t>				codes;		// doc 8643, in file order
+	std::vector<std::pair<std::string, std::string>>	headers;	// name and path of every package in gPackages
+
+	std::vector<Package_t>						packages;
+
+	// False (and empty) if there is no usable cache in inFile.  Interns the catalog's strings.
+	bool			read(const std::string& inFile);
+	bool			write(const std::string& inFile) const;
+
+	// The package at inPath if it's cached and none of its files changed, else null.
+	const Package_t *	findValid(const std::string& inPath) const;
+
+	// The files a parsed package depends on - see above.
+	static void		collectDeps(const CSLPackage_t& inPackage, const std::string& inPackageFile, std::vector<CSLFileStamp_t>& outDeps);
+
+private:
+	bool			discard() { *this = CSLCatalogCache(); return false; }
+
+	std::unordered_map<std::string, size_t>		mByPath;	// into packages, filled by read
+};
+
+#endif /* XPMPCATALOGCACHE_H */
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "XPMPCommandQueue.h"
+#include "XPLMDataAccess.h"
+
+#include <string>
+#include <vector>
+
+XPMPCommandQueue_t		gCommandQueue;
+
+static std::vector<XPLMDataRef>		gQueueDataRefs;
+
+static const char * kQueueCounterNames[4] = { "depth", "max_depth", "dropped", "applied_last_frame" };
+
+static int	XPMPGetQueueCounter(void * inRefcon)
+{
+	switch (reinterpret_cast<intptr_t>(inRefcon)) {
+	case 0:		return static_cast<int>(gCommandQueue.queue.depth());
+	case 1:		return static_cast<int>(gCommandQueue.maxDepth.load(std::memory_order_relaxed));
+	case 2:		return static_cast<int>(gCommandQueue.dropped.load(std::memory_order_relaxed));
+	default:	return static_cast<int>(gCommandQueue.appliedLastFrame.load(std::memory_order_relaxed));
+	}
+}
+
+void XPMPInitCommandQueueDataRefs()
+{
+	if (!gQueueDataRefs.empty())
+		return;
+	for (int n = 0; n < 4; ++n)
+	{
+		std::string name = std::string("libxplanemp/queue/") + kQueueCounterNames[n];
+		gQueueDataRefs.push_back(XPLMRegisterDataAccessor(name.c_str(), xplmType_Int, 0,
+								XPMPGetQueueCounter, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+								reinterpret_cast<void *>(intptr_t(n)), NULL));
+	}
+}
+
+void XPMPDeinitCommandQueueDataRefs()
+{
+	for (XPLMDataRef ref : gQueueDataRefs)
+		XPLMUnregisterDataAccessor(ref);
+	gQueueDataRefs.clear();
+}
@@ -0,0 +1,191 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef XPMPCOMMANDQUEUE_H
+#define XPMPCOMMANDQUEUE_H
+
+/*
+ * XPMPCommandQueue
+ *
+ * The thread-safe way in: any thread may queue creates, destroys, model changes and
+ * state updates, the main thread applies them once a frame before drawing (see
+ * XPMPRenderMultiplayerPlanes).  The queue is a bounded array of cells, each with a
+ * sequence number that tells producers and consumers whose turn the cell is - no
+ * locks, and a full queue makes the producer fail rather than wait.
+ *
+ * Queued creates need their handle right away, but only the main thread may touch
+ * gPlanes, so it keeps a second queue topped up with reserved handles that any thread
+ * can take one from.
+ *
+ */
+
+#include "XPMPMultiplayerVars.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+
+// Bounded queue for any number of producer and consumer threads.
+template <class T>
+class BoundedQueue {
+
+public:
+	// Not thread-safe - call before any thread pushes.
+	void init(size_t inCapacity)
+	{
+		size_t cap = 2;
+		while (cap < inCapacity)
+			cap <<= 1;
+		mCells.reset(new Cell[cap]);
+		for (size_t i = 0; i < cap; ++i)
+			mCells[i].seq.store(i, std::memory_order_relaxed);
+		mMask = cap - 1;
+		mEnqueuePos.store(0, std::memory_order_relaxed);
+		mDequeuePos.store(0, std::memory_order_relaxed);
+	}
+
+	void deinit()							{ mCells.reset(); mMask = 0; }
+
+	bool	ready() const					{ return mCells != nullptr; }
+	size_t	capacity() const				{ return mCells ? mMask + 1 : 0; }
+
+	// Approximate while other threads are busy.
+	size_t	depth() const
+	{
+		const size_t enq = mEnqueuePos.load(std::memory_order_relaxed);
+		const size_t deq = mDequeuePos.load(std::memory_order_relaxed);
+		return enq > deq ? enq - deq : 0;
+	}
+
+	// Any thread.  Returns false if the queue is full; inItem is left alone then.
+	bool push(T && inItem)
+	{
+		Cell * cell;
+		size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			cell = &mCells[pos & mMask];
+			const size_t seq = cell->seq.load(std::memory_order_acquire);
+			const intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+			if (dif == 0)
+			{
+				if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (dif < 0)
+				return false;
+			else
+				pos = mEnqueuePos.load(std::memory_order_relaxed);
+		}
+		cell->item = std::move(inItem);
+		cell->seq.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Any thread.  Returns false if the queue is empty.
+	bool pop(T & outItem)
+	{
+		Cell * cell;
+		size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			cell = &mCells[pos & mMask];
+			const size_t seq = cell->seq.load(std::memory_order_acquire);
+			const intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+			if (dif == 0)
+			{
+				if (mDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (dif < 0)
+				return false;
+			else
+				pos = mDequeuePos.load(std::memory_order_relaxed);
+		}
+		outItem = std::move(cell->item);
+		cell->item = T();
+		cell->seq.store(pos + mMask + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	struct Cell {
+		std::atomic<size_t>		seq;
+		T						item;
+	};
+
+	std::unique_ptr<Cell[]>		mCells;
+	size_t						mMask = 0;
+	// apart, so producers and the consumer don't fight over one cache line
+	alignas(64) std::atomic<size_t>	mEnqueuePos{0};
+	alignas(64) std::atomic<size_t>	mDequeuePos{0};
+};
+
+enum XPMPCommandType {
+	xpmpCmd_None,
+	xpmpCmd_Create,
+	xpmpCmd_Destroy,
+	xpmpCmd_ChangeModel,
+	xpmpCmd_Update,
+	xpmpCmd_Snapshot
+};
+
+// One queued call, with everything copied - the caller's buffers are gone by the time
+// we get to it.
+struct XPMPCommand_t {
+	XPMPCommandType					type = xpmpCmd_None;
+	XPMPPlaneID						plane = nullptr;	// xpmpCmd_Create: the reserved handle
+	string							icao;				// xpmpCmd_Create, xpmpCmd_ChangeModel
+	string							airline;
+	string							livery;
+	XPMPPlaneData_f					dataFunc = nullptr;	// xpmpCmd_Create
+	void *							ref = nullptr;
+	int								dataMask = 0;		// xpmpCmd_Update: xpmpDataType_ bits that are set
+	XPMPPlanePosition_t				pos;
+	XPMPPlaneSurfaces_t				surface;
+	XPMPPlaneRadar_t				radar;
+	XPMPPlaneSnapshot_t				snapshot;			// xpmpCmd_Snapshot
+};
+
+struct XPMPCommandQueue_t {
+	BoundedQueue<XPMPCommand_t>	queue;
+	BoundedQueue<XPMPPlaneID>	handles;			// reserved for XPMPQueueCreatePlane
+	std::mutex					orphanLock;
+	std::vector<XPMPPlaneID>	orphans;			// reserved handles that couldn't go back - the main thread drops them
+	std::atomic<size_t>			dropped{0};			// commands refused because the queue was full
+	// written by the main thread only, but XPMPGetQueueStats may read them from anywhere
+	std::atomic<size_t>			applied{0};
+	std::atomic<size_t>			appliedLastFrame{0};
+	std::atomic<size_t>			maxDepth{0};		// deepest the queue was at a drain
+	int							lastCycle = -1;
+};
+
+extern XPMPCommandQueue_t		gCommandQueue;
+
+// Registers / removes the libxplanemp/queue/ datarefs.
+void XPMPInitCommandQueueDataRefs();
+void XPMPDeinitCommandQueueDataRefs();
+
+#endif /* XPMPCOMMANDQUEUE_H */
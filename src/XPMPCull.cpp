@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "XPMPCull.h"
+
+#if defined(__AVX2__)
+#define XPMP_CULL_AVX2	1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define XPMP_CULL_SSE2	1
+#include <emmintrin.h>
+#endif
+
+/*
+ * The scalar versions are the reference - the SIMD kernels below must give the same
+ * answer, which is why the clip tests are written as "not less than" (a NaN position
+ * counts as visible, just like it always did).
+ *
+ */
+
+static inline bool cull_one(const cull_info_t& i, float r, float x, float y, float z, float * outDistSqr)
+{
+	// First: we transform our coordinate into eye coordinates from model-view.
+	float xp = x * i.model_view[0] + y * i.model_view[4] + z * i.model_view[ 8] + i.model_view[12];
+	float yp = x * i.model_view[1] + y * i.model_view[5] + z * i.model_view[ 9] + i.model_view[13];
+	float zp = x * i.model_view[2] + y * i.model_view[6] + z * i.model_view[10] + i.model_view[14];
+	*outDistSqr = xp*xp+yp*yp+zp*zp;
+
+	// Now - we apply the "plane equation" of each clip plane to see how far from the clip plane our point is.
+	// The clip planes are directed: positive number distances mean we are INSIDE our viewing area by some distance;
+	// negative means outside.  So ... if we are outside by less than -r, the ENTIRE sphere is out of bounds.
+	if ((xp * i.nea_clip[0] + yp * i.nea_clip[1] + zp * i.nea_clip[2] + i.nea_clip[3] + r) < 0)	return false;
+	if ((xp * i.bot_clip[0] + yp * i.bot_clip[1] + zp * i.bot_clip[2] + i.bot_clip[3] + r) < 0)	return false;
+	if ((xp * i.top_clip[0] + yp * i.top_clip[1] + zp * i.top_clip[2] + i.top_clip[3] + r) < 0)	return false;
+	if ((xp * i.lft_clip[0] + yp * i.lft_clip[1] + zp * i.lft_clip[2] + i.lft_clip[3] + r) < 0)	return false;
+	if ((xp * i.rgt_clip[0] + yp * i.rgt_clip[1] + zp * i.rgt_clip[2] + i.rgt_clip[3] + r) < 0)	return false;
+	if ((xp * i.far_clip[0] + yp * i.far_clip[1] + zp * i.far_clip[2] + i.far_clip[3] + r) < 0)	return false;
+	return true;
+}
+
+static inline void project_one(const cull_info_t& i, const int * vp, float x, float y, float z, float * out_x, float * out_y)
+{
+	float xe = x * i.model_view[0] + y * i.model_view[4] + z * i.model_view[ 8] + i.model_view[12];
+	float ye = x * i.model_view[1] + y * i.model_view[5] + z * i.model_view[ 9] + i.model_view[13];
+	float ze = x * i.model_view[2] + y * i.model_view[6] + z * i.model_view[10] + i.model_view[14];
+	float we = x * i.model_view[3] + y * i.model_view[7] + z * i.model_view[11] + i.model_view[15];
+
+	float xc = xe * i.proj[0] + ye * i.proj[4] + ze * i.proj[ 8] + we * i.proj[12];
+	float yc = xe * i.proj[1] + ye * i.proj[5] + ze * i.proj[ 9] + we * i.proj[13];
+	float wc = xe * i.proj[3] + ye * i.proj[7] + ze * i.proj[11] + we * i.proj[15];
+
+	xc /= wc;
+	yc /= wc;
+
+	*out_x = static_cast<float>(vp[0]) + (1.0f + xc) * static_cast<float>(vp[2]) / 2.0f;
+	*out_y = static_cast<float>(vp[1]) + (1.0f + yc) * static_cast<float>(vp[3]) / 2.0f;
+}
+
+#if XPMP_CULL_AVX2
+
+typedef __m256				vfloat;
+const size_t				kLanes = 8;
+#define	V_SET1(a)			_mm256_set1_ps(a)
+#define	V_LOAD(p)			_mm256_loadu_ps(p)
+#define	V_STORE(p, a)		_mm256_storeu_ps(p, a)
+#define	V_ADD(a, b)			_mm256_add_ps(a, b)
+#define	V_MUL(a, b)			_mm256_mul_ps(a, b)
+#define	V_DIV(a, b)			_mm256_div_ps(a, b)
+#define	V_MADD(a, b, c)		_mm256_add_ps(_mm256_mul_ps(a, b), c)
+#define	V_NOTLESS(a, b)		_mm256_cmp_ps(a, b, _CMP_NLT_UQ)
+#define	V_AND(a, b)			_mm256_and_ps(a, b)
+#define	V_MASK(a)			static_cast<uint32_t>(_mm256_movemask_ps(a))
+
+#elif XPMP_CULL_SSE2
+
+typedef __m128				vfloat;
+const size_t				kLanes = 4;
+#define	V_SET1(a)			_mm_set1_ps(a)
+#define	V_LOAD(p)			_mm_loadu_ps(p)
+#define	V_STORE(p, a)		_mm_storeu_ps(p, a)
+#define	V_ADD(a, b)			_mm_add_ps(a, b)
+#define	V_MUL(a, b)			_mm_mul_ps(a, b)
+#define	V_DIV(a, b)			_mm_div_ps(a, b)
+#define	V_MADD(a, b, c)		_mm_add_ps(_mm_mul_ps(a, b), c)
+#define	V_NOTLESS(a, b)		_mm_cmpnlt_ps(a, b)
+#define	V_AND(a, b)			_mm_and_ps(a, b)
+#define	V_MASK(a)			static_cast<uint32_t>(_mm_movemask_ps(a))
+
+#endif
+
+#if XPMP_CULL_AVX2 || XPMP_CULL_SSE2
+
+// One clip plane against all lanes: inside &= (plane(p) + r >= 0)
+static inline vfloat clip_lanes(vfloat inside, const float * c, vfloat xp, vfloat yp, vfloat zp, vfloat r, vfloat zero)
+{
+	vfloat d = V_MADD(xp, V_SET1(c[0]), V_MADD(yp, V_SET1(c[1]), V_MADD(zp, V_SET1(c[2]), V_ADD(V_SET1(c[3]), r))));
+	return V_AND(inside, V_NOTLESS(d, zero));
+}
+
+#endif
+
+void	cull_spheres(const cull_info_t& i, float r, cull_buffer_t& buf)
+{
+	// Pad to the batch width so the kernel never needs a tail loop.  The padding
+	// entries are at the origin; whatever the kernel says about them is ignored.
+	size_t padded = (buf.count + kCullBatchWidth - 1) / kCullBatchWidth * kCullBatchWidth;
+	buf.x.resize(padded, 0.0f);
+	buf.y.resize(padded, 0.0f);
+	buf.z.resize(padded, 0.0f);
+	buf.dist_sqr.resize(padded);
+	buf.visible.assign((padded + 31) / 32, 0);
+
+	const float * px = buf.x.data();
+	const float * py = buf.y.data();
+	const float * pz = buf.z.data();
+	float * pd = buf.dist_sqr.data();
+	uint32_t * pv = buf.visible.data();
+
+#if XPMP_CULL_AVX2 || XPMP_CULL_SSE2
+	const vfloat m0  = V_SET1(i.model_view[0]),  m1  = V_SET1(i.model_view[1]),  m2  = V_SET1(i.model_view[2]);
+	const vfloat m4  = V_SET1(i.model_view[4]),  m5  = V_SET1(i.model_view[5]),  m6  = V_SET1(i.model_view[6]);
+	const vfloat m8  = V_SET1(i.model_view[8]),  m9  = V_SET1(i.model_view[9]),  m10 = V_SET1(i.model_view[10]);
+	const vfloat m12 = V_SET1(i.model_view[12]), m13 = V_SET1(i.model_view[13]), m14 = V_SET1(i.model_view[14]);
+	const vfloat vr = V_SET1(r);
+	const vfloat zero = V_SET1(0.0f);
+	const vfloat all = V_NOTLESS(zero, zero);
+
+	for (size_t n = 0; n < padded; n += kLanes)
+	{
+		vfloat x = V_LOAD(px + n), y = V_LOAD(py + n), z = V_LOAD(pz + n);
+		vfloat xp = V_MADD(x, m0, V_MADD(y, m4, V_MADD(z, m8,  m12)));
+		vfloat yp = V_MADD(x, m1, V_MADD(y, m5, V_MADD(z, m9,  m13)));
+		vfloat zp = V_MADD(x, m2, V_MADD(y, m6, V_MADD(z, m10, m14)));
+		V_STORE(pd + n, V_MADD(xp, xp, V_MADD(yp, yp, V_MUL(zp, zp))));
+
+		vfloat inside = all;
+		inside = clip_lanes(inside, i.nea_clip, xp, yp, zp, vr, zero);
+		inside = clip_lanes(inside, i.bot_clip, xp, yp, zp, vr, zero);
+		inside = clip_lanes(inside, i.top_clip, xp, yp, zp, vr, zero);
+		inside = clip_lanes(inside, i.lft_clip, xp, yp, zp, vr, zero);
+		inside = clip_lanes(inside, i.rgt_clip, xp, yp, zp, vr, zero);
+		inside = clip_lanes(inside, i.far_clip, xp, yp, zp, vr, zero);
+		pv[n >> 5] |= V_MASK(inside) << (n & 31);
+	}
+#else
+	for (size_t n = 0; n < padded; ++n)
+		if (cull_one(i, r, px[n], py[n], pz[n], pd + n))
+			pv[n >> 5] |= 1u << (n & 31);
+#endif
+}
+
+void	cull_project_points(const cull_info_t& i, const int * vp,
+							const float * px, const float * py, const float * pz, size_t count,
+							float * out_x, float * out_y)
+{
+	size_t n = 0;
+#if XPMP_CULL_AVX2 || XPMP_CULL_SSE2
+	// model view * proj collapsed into one 4x3 transform (we only need clip x, y and w)
+	float c[12];
+	for (int col = 0; col < 3; ++col) {
+		const int pc = (col == 2) ? 3 : col;
+		for (int row = 0; row < 4; ++row)
+			c[col * 4 + row] =	i.model_view[row * 4 + 0] * i.proj[ 0 + pc] +
+								i.model_view[row * 4 + 1] * i.proj[ 4 + pc] +
+								i.model_view[row * 4 + 2] * i.proj[ 8 + pc] +
+								i.model_view[row * 4 + 3] * i.proj[12 + pc];
+	}
+	const vfloat half_w = V_SET1(static_cast<float>(vp[2]) / 2.0f), half_h = V_SET1(static_cast<float>(vp[3]) / 2.0f);
+	const vfloat org_x = V_SET1(static_cast<float>(vp[0])), org_y = V_SET1(static_cast<float>(vp[1]));
+	const vfloat one = V_SET1(1.0f);
+	for (; n + kLanes <= count; n += kLanes)
+	{
+		vfloat x = V_LOAD(px + n), y = V_LOAD(py + n), z = V_LOAD(pz + n);
+		vfloat xc = V_MADD(x, V_SET1(c[0]), V_MADD(y, V_SET1(c[1]), V_MADD(z, V_SET1(c[2]),  V_SET1(c[3]))));
+		vfloat yc = V_MADD(x, V_SET1(c[4]), V_MADD(y, V_SET1(c[5]), V_MADD(z, V_SET1(c[6]),  V_SET1(c[7]))));
+		vfloat wc = V_MADD(x, V_SET1(c[8]), V_MADD(y, V_SET1(c[9]), V_MADD(z, V_SET1(c[10]), V_SET1(c[11]))));
+		V_STORE(out_x + n, V_MADD(V_ADD(one, V_DIV(xc, wc)), half_w, org_x));
+		V_STORE(out_y + n, V_MADD(V_ADD(one, V_DIV(yc, wc)), half_h, org_y));
+	}
+#endif
+	for (; n < count; ++n)
+		project_one(i, vp, px[n], py[n], pz[n], out_x + n, out_y + n);
+}
+
+const char *	cull_kernel_name()
+{
+#if XPMP_CULL_AVX2
+	return "avx2";
+#elif XPMP_CULL_SSE2
+	return "sse2";
+#else
+	return "scalar";
+#endif
+}
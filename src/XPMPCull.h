@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef XPMPCULL_H
+#define XPMPCULL_H
+
+/*
+ * XPMPCull
+ *
+ * Batch culling kernels for the default renderer.  Instead of testing one plane at a
+ * time against the camera, the renderer fills a structure-of-arrays position buffer
+ * and runs one kernel over all of them: transform to eye coordinates, distance and
+ * all six clip planes, 4 (SSE2) or 8 (AVX2) planes per instruction.  Without SIMD
+ * support we fall back to plain scalar code with identical results.
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+struct cull_info_t {					// This struct has everything we need to cull fast!
+	float	model_view[16];				// The model view matrix, to get from local OpenGL to eye coordinates.
+	float	proj[16];					// Proj matrix - this is just a hack to use for gluProject.
+	float	nea_clip[4];				// Four clip planes in the form of Ax + By + Cz + D = 0 (ABCD are in the array.)
+	float	far_clip[4];				// They are oriented so the positive side of the clip plane is INSIDE the view volume.
+	float	lft_clip[4];
+	float	rgt_clip[4];
+	float	bot_clip[4];
+	float	top_clip[4];
+};
+
+// Number of planes the widest kernel handles at once; buffers are padded to this.
+const size_t	kCullBatchWidth = 8;
+
+/*
+ * cull_buffer_t
+ *
+ * Structure-of-arrays buffer of local OpenGL positions plus the kernel outputs.  It is
+ * meant to be kept around from frame to frame: clear() keeps the capacity.
+ *
+ */
+struct cull_buffer_t {
+	std::vector<float>		x;
+	std::vector<float>		y;
+	std::vector<float>		z;
+	std::vector<float>		dist_sqr;		// output: squared distance from the camera
+	std::vector<uint32_t>	visible;		// output: one bit per entry, set if the sphere is in the frustum
+	size_t					count = 0;
+
+	void	clear() { count = 0; x.clear(); y.clear(); z.clear(); }
+	void	push_back(float inX, float inY, float inZ) { x.push_back(inX); y.push_back(inY); z.push_back(inZ); ++count; }
+	bool	is_visible(size_t i) const { return (visible[i >> 5] >> (i & 31)) & 1; }
+};
+
+/*
+ * cull_spheres
+ *
+ * Computes dist_sqr and the visible bitmask for every position in the buffer, treating each
+ * position as a sphere of radius inRadius.  Pads the buffer to a multiple of kCullBatchWidth.
+ *
+ */
+void	cull_spheres(const cull_info_t& inInfo, float inRadius, cull_buffer_t& ioBuffer);
+
+/*
+ * cull_project_points
+ *
+ * Projects inCount local OpenGL points to window coordinates through the model view and
+ * projection matrices and the viewport (left, bottom, width, height).  This is the batch
+ * version of gluProject, used for labels.
+ *
+ */
+void	cull_project_points(const cull_info_t& inInfo, const int * inViewport,
+							const float * inX, const float * inY, const float * inZ, size_t inCount,
+							float * outX, float * outY);
+
+/*
+ * cull_kernel_name
+ *
+ * Returns which kernel was compiled in ("avx2", "sse2" or "scalar"), for the log.
+ *
+ */
+const char *	cull_kernel_name();
+
+#endif /* XPMPCULL_H */
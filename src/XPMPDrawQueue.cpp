@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "XPMPDrawQueue.h"
+
+#include <string.h>
+
+void DrawQueue::sort()
+{
+	const size_t n = mItems.size();
+	mScratch.resize(n);
+
+	// One counting pass per byte, least significant first.  A byte that is the same
+	// for every key (most of them, usually) doesn't need its pass.
+	DrawQueueItem_t * src = mItems.data();
+	DrawQueueItem_t * dst = mScratch.data();
+	for (int shift = 0; shift < 64 && n > 1; shift += 8)
+	{
+		size_t count[256];
+		memset(count, 0, sizeof(count));
+		for (size_t i = 0; i < n; ++i)
+			++count[(src[i].key >> shift) & 0xFF];
+		if (count[(src[0].key >> shift) & 0xFF] == n)
+			continue;
+
+		size_t pos = 0;
+		for (int b = 0; b < 256; ++b)
+		{
+			size_t c = count[b];
+			count[b] = pos;
+			pos += c;
+		}
+		for (size_t i = 0; i < n; ++i)
+			dst[count[(src[i].key >> shift) & 0xFF]++] = src[i];
+
+		DrawQueueItem_t * t = src;
+		src = dst;
+		dst = t;
+	}
+	if (src != mItems.data())
+		memcpy(mItems.data(), src, n * sizeof(DrawQueueItem_t));
+
+	size_t i = 0;
+	for (int pass = 0; pass <= draw_PassCount; ++pass)
+	{
+		while (i < n && int(mItems[i].key >> 60) < pass)
+			++i;
+		mPassBegin[pass] = i;
+	}
+	mPassBegin[draw_PassCount] = n;
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef XPMPDRAWQUEUE_H
+#define XPMPDRAWQUEUE_H
+
+/*
+ * XPMPDrawQueue
+ *
+ * Every visible plane becomes one entry in the draw queue, with a 64 bit key that packs
+ * the pass it is drawn in and the OpenGL state it needs:
+ *
+ *   63..60 pass   59..40 model   39..26 texture   25..12 lit texture   11..0 LOD
+ *
+ * Sorting the keys (LSD radix sort, stable, so planes with equal keys stay in the order
+ * they were pushed - render list order, not distance) puts each pass into one
+ * contiguous range, and within a pass groups planes that share a model and textures,
+ * so state only changes between groups.  The fields are truncated
+ * to their width - a collision merely splits or mixes a group, it never draws wrong.
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+enum {
+	draw_NoModel = 0,		// no CSL model, drawn as Austin's plane 1
+	draw_Austin,
+	draw_Obj7,
+	draw_Obj8,
+	draw_Obj7Lights,
+	draw_PassCount
+};
+
+inline uint64_t draw_make_key(unsigned inPass, uint64_t inModel, unsigned inTex, unsigned inLit, unsigned inLod)
+{
+	return (uint64_t(inPass & 0xF) << 60) |
+		   ((inModel & 0xFFFFF) << 40) |
+		   (uint64_t(inTex & 0x3FFF) << 26) |
+		   (uint64_t(inLit & 0x3FFF) << 12) |
+		   uint64_t(inLod & 0xFFF);
+}
+
+// Folds a pointer into the model field of a key.
+inline uint64_t draw_model_id(const void * inModel)
+{
+	uint64_t p = uint64_t(uintptr_t(inModel)) >> 4;
+	return p ^ (p >> 20) ^ (p >> 40);
+}
+
+struct DrawQueueItem_t {
+	uint64_t	key;
+	uint32_t	index;		// into the caller's plane list
+};
+
+class DrawQueue {
+
+public:
+	void clear()										{ mItems.clear(); }
+	void push(uint64_t inKey, uint32_t inIndex)			{ mItems.push_back({ inKey, inIndex }); }
+
+	// Sorts by key and finds the range of each pass.
+	void sort();
+
+	// [begin, end) of the items of one pass, valid after sort().
+	const DrawQueueItem_t * begin(int inPass) const		{ return mItems.data() + mPassBegin[inPass]; }
+	const DrawQueueItem_t * end(int inPass) const		{ return mItems.data() + mPassBegin[inPass + 1]; }
+	bool empty(int inPass) const						{ return mPassBegin[inPass] == mPassBegin[inPass + 1]; }
+
+private:
+	std::vector<DrawQueueItem_t>	mItems;
+	std::vector<DrawQueueItem_t>	mScratch;
+	size_t							mPassBegin[draw_PassCount + 1] = {};
+};
+
+#endif /* XPMPDRAWQUEUE_H */
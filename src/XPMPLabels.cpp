@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "XPMPLabels.h"
+
+#include "XPLMGraphics.h"
+
+#include <string.h>
+
+bool label_update_layout(LabelLayout_t & ioLayout, const char * inText, const float inColor[4])
+{
+	if (ioLayout.width >= 0 &&
+		strncmp(ioLayout.text, inText, sizeof(ioLayout.text)) == 0 &&
+		memcmp(ioLayout.color, inColor, sizeof(ioLayout.color)) == 0)
+		return false;
+
+	strncpy(ioLayout.text, inText, sizeof(ioLayout.text) - 1);
+	ioLayout.text[sizeof(ioLayout.text) - 1] = 0;
+	memcpy(ioLayout.color, inColor, sizeof(ioLayout.color));
+
+	int charHeight = 0;
+	XPLMGetFontDimensions(xplmFont_Basic, NULL, &charHeight, NULL);
+	ioLayout.width = static_cast<int>(XPLMMeasureString(xplmFont_Basic, ioLayout.text, (int)strlen(ioLayout.text)) + 0.5f);
+	ioLayout.height = charHeight;
+	return true;
+}
+
+void LabelDeclutter::reset(int inWidth, int inHeight)
+{
+	mWidth = inWidth > 0 ? inWidth : 0;
+	mHeight = inHeight > 0 ? inHeight : 0;
+	mCols = (mWidth + kCellSize - 1) / kCellSize;
+	mRows = (mHeight + kCellSize - 1) / kCellSize;
+	mTaken.assign(mCols * mRows, 0);
+}
+
+bool LabelDeclutter::place(int inX, int inY, int inWidth, int inHeight)
+{
+	if (inWidth <= 0 || inHeight <= 0)
+		return false;
+	if (inX >= mWidth || inY >= mHeight || inX + inWidth <= 0 || inY + inHeight <= 0)
+		return false;
+
+	// partly off screen is fine, only the visible part takes cells
+	int c0 = inX > 0 ? inX / kCellSize : 0;
+	int r0 = inY > 0 ? inY / kCellSize : 0;
+	int c1 = (inX + inWidth - 1) / kCellSize;
+	int r1 = (inY + inHeight - 1) / kCellSize;
+	if (c1 >= mCols) c1 = mCols - 1;
+	if (r1 >= mRows) r1 = mRows - 1;
+
+	for (int r = r0; r <= r1; ++r)
+		for (int c = c0; c <= c1; ++c)
+			if (mTaken[r * mCols + c])
+				return false;
+	for (int r = r0; r <= r1; ++r)
+		memset(&mTaken[r * mCols + c0], 1, c1 - c0 + 1);
+	return true;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef XPMPLABELS_H
+#define XPMPLABELS_H
+
+/*
+ * XPMPLabels
+ *
+ * Support for drawing aircraft labels.  At a busy airport hundreds of labels pile up
+ * on top of each other, and nobody can read any of them anyway.  Labels are placed
+ * nearest plane first into a coarse occupancy grid of the screen; a label that would
+ * cover a cell already taken is not drawn at all.  The pixel size of each label is
+ * measured once and kept with the plane until its text or colour changes.
+ *
+ */
+
+#include <stdint.h>
+#include <vector>
+
+// Measured layout of one plane's label - lives in XPMPPlane_t.
+struct LabelLayout_t {
+	char		text[32] = "";			// text the layout was made for
+	float		color[4] = {0, 0, 0, 0};	// colour the layout was made for
+	int			width = -1;				// pixels, -1 = not measured yet
+	int			height = 0;
+};
+
+// Brings the layout up to date with the plane's label; returns true if it had to
+// be measured again.
+bool			label_update_layout(
+		LabelLayout_t &			ioLayout,
+		const char *			inText,
+		const float				inColor[4]);
+
+class LabelDeclutter {
+
+public:
+	// Clears the grid for a screen of the given size.
+	void reset(int inWidth, int inHeight);
+
+	// Tries to place a label with its lower left corner at x/y.  Returns false if it
+	// is off screen or would overlap a label placed before; otherwise the label's
+	// cells are taken.
+	bool place(int inX, int inY, int inWidth, int inHeight);
+
+private:
+	static const int		kCellSize = 8;		// pixels
+
+	int						mCols = 0;
+	int						mRows = 0;
+	int						mWidth = 0;
+	int						mHeight = 0;
+	std::vector<uint8_t>	mTaken;
+};
+
+#endif /* XPMPLABELS_H */
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "XPMPLodBudget.h"
+#include "XPMPMultiplayerVars.h"
+
+#include <algorithm>
+
+LodBudgetController gLodBudget;
+
+// How fast the smoothed cost follows the measured one.
+static const float kSmoothing = 0.1f;
+
+static inline double lerp(double inMin, double inMax, float inT)
+{
+	return inMin + (inMax - inMin) * inT;
+}
+
+void LodBudgetController::reset()
+{
+	mLevel = 1.0f;
+	mSmoothedUs = 0.0f;
+	mOverFrames = mUnderFrames = 0;
+}
+
+void LodBudgetController::update(float inFrameUs)
+{
+	if (!gPrefs.adaptive_lod)
+	{
+		if (mLevel != 1.0f || mSmoothedUs != 0.0f)
+			reset();
+		return;
+	}
+
+	mSmoothedUs = mSmoothedUs == 0.0f ? inFrameUs : mSmoothedUs + kSmoothing * (inFrameUs - mSmoothedUs);
+
+	const float budgetUs = gPrefs.lod_budget_ms * 1000.0f;
+	const float band = budgetUs * gPrefs.lod_hysteresis;
+
+	if (mSmoothedUs > budgetUs + band)
+	{
+		mUnderFrames = 0;
+		if (++mOverFrames >= gPrefs.lod_hold_frames && mLevel > 0.0f)
+		{
+			mLevel = std::max(0.0f, mLevel - gPrefs.lod_step);
+			mOverFrames = 0;
+		}
+	}
+	else if (mSmoothedUs < budgetUs - band)
+	{
+		mOverFrames = 0;
+		if (++mUnderFrames >= gPrefs.lod_hold_frames && mLevel < 1.0f)
+		{
+			mLevel = std::min(1.0f, mLevel + gPrefs.lod_step);
+			mUnderFrames = 0;
+		}
+	}
+	else
+		mOverFrames = mUnderFrames = 0;
+}
+
+void LodBudgetController::apply(LodLimits_t &ioLimits) const
+{
+	if (mLevel >= 1.0f)
+		return;
+
+	// never go above what the prefs ask for, even if the minimums are set higher
+	const int minFull = std::min(gPrefs.lod_min_full_count, ioLimits.maxFullPlanes);
+	ioLimits.maxFullPlanes = static_cast<int>(lerp(minFull, ioLimits.maxFullPlanes, mLevel) + 0.5);
+	ioLimits.fullPlaneDist *= lerp(std::min(gPrefs.lod_min_full_distance_scale, 1.0f), 1.0, mLevel);
+	ioLimits.labelDist *= lerp(std::min(gPrefs.lod_min_label_distance_scale, 1.0f), 1.0, mLevel);
+	ioLimits.drawDist *= lerp(std::min(gPrefs.lod_min_draw_distance_scale, 1.0f), 1.0, mLevel);
+}
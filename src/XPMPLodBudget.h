@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef XPMPLODBUDGET_H
+#define XPMPLODBUDGET_H
+
+/*
+ * XPMPLodBudget
+ *
+ * Optional adaptive level of detail.  Once a frame the controller looks at what the
+ * renderer cost in the frame before and moves a single detail level between 0 (the
+ * configured minimums) and 1 (the normal prefs).  The cost is xpmpStage_Total less
+ * xpmpStage_DataPull: the data pull is mostly the clients' callbacks, and a slow client
+ * shouldn't cost everybody detail that wouldn't buy that time back.  It only steps down when a smoothed
+ * cost stays above the budget plus a hysteresis band for a number of frames, and only
+ * steps up when it stays below the budget minus the band, so the detail doesn't
+ * flicker back and forth around the budget.
+ *
+ */
+
+struct LodLimits_t {
+	int			maxFullPlanes;		// planes drawn in full
+	double		fullPlaneDist;		// meters, full planes only within this
+	double		labelDist;			// meters
+	double		drawDist;			// meters, beyond this planes aren't drawn at all
+};
+
+class LodBudgetController {
+
+public:
+	// Feed the cost of the last frame (RenderStats::lastFrameRenderUs); call once per frame.
+	void update(float inFrameUs);
+
+	// Scales the normal limits down to the current level.
+	void apply(LodLimits_t &ioLimits) const;
+
+	float level() const			{ return mLevel; }
+	void reset();
+
+private:
+	float		mLevel = 1.0f;
+	float		mSmoothedUs = 0.0f;
+	int			mOverFrames = 0;
+	int			mUnderFrames = 0;
+};
+
+extern LodBudgetController gLodBudget;
+
+#endif /* XPMPLODBUDGET_H */
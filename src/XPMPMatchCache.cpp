@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "XPMPMatchCache.h"
+
+MatchCache		gMatchCache;
+
+void MatchCache::sync(const CSLMatchParams_t& inParams)
+{
+	const unsigned generation = mGeneration.load();
+	mCapacity = static_cast<size_t>(inParams.cacheSize > 0 ? inParams.cacheSize : 0);
+	if (generation != mFilledGeneration || inParams.aircraftCount != mAircraftCount)
+	{
+		mLRU.clear();
+		mEntries.clear();
+		mFilledGeneration = generation;
+		mAircraftCount = inParams.aircraftCount;
+	}
+	while (mLRU.size() > mCapacity)
+	{
+		mEntries.erase(mLRU.back().first);
+		mLRU.pop_back();
+	}
+}
+
+bool MatchCache::lookup(const CSLMatchParams_t& inParams, const std::string& inKey, Result_t& outResult, unsigned& outGeneration)
+{
+	std::lock_guard<std::mutex> lock(mLock);
+	sync(inParams);
+	outGeneration = mFilledGeneration;
+	auto i = mEntries.find(inKey);
+	if (i == mEntries.end())
+	{
+		++mMisses;
+		return false;
+	}
+	++mHits;
+	mLRU.splice(mLRU.begin(), mLRU, i->second);
+	outResult = i->second->second;
+	return true;
+}
+
+void MatchCache::store(const CSLMatchParams_t& inParams, const std::string& inKey, const Result_t& inResult, unsigned inGeneration)
+{
+	std::lock_guard<std::mutex> lock(mLock);
+	sync(inParams);
+	if (inGeneration != mFilledGeneration || mCapacity == 0)
+		return;
+	auto i = mEntries.find(inKey);
+	if (i != mEntries.end())
+	{
+		i->second->second = inResult;
+		mLRU.splice(mLRU.begin(), mLRU, i->second);
+		return;
+	}
+	if (mLRU.size() >= mCapacity)
+	{
+		mEntries.erase(mLRU.back().first);
+		mLRU.pop_back();
+	}
+	mLRU.emplace_front(inKey, inResult);
+	mEntries.emplace(inKey, mLRU.begin());
+}
+
+void MatchCache::stats(size_t& outEntries, size_t& outCapacity, size_t& outHits, size_t& outMisses)
+{
+	std::lock_guard<std::mutex> lock(mLock);
+	outEntries = mLRU.size();
+	outCapacity = mCapacity;
+	outHits = mHits;
+	outMisses = mMisses;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef XPMPMATCHCACHE_H
+#define XPMPMATCHCACHE_H
+
+/*
+ * XPMPMatchCache
+ *
+ * Live traffic asks for the same few hundred ICAO/airline/livery combinations over and
+ * over, so CSL_MatchPlane remembers its last results, least recently used out first.
+ *
+ * Anything that can change a match result bumps the generation: loading packages,
+ * a new default ICAO, (re)assigning Austin's planes.  A change of the sim's aircraft
+ * count is caught by the cache itself.  Results computed against an older generation
+ * are not stored.  Called from the main thread and the background matcher, so all of
+ * it is behind a mutex.
+ *
+ */
+
+#include "XPMPMultiplayerCSL.h"
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class MatchCache {
+
+public:
+	struct Result_t {
+		CSLPlane_t *		model = nullptr;
+		int					quality = -1;
+	};
+
+	// True and outResult filled if cached.  outGeneration is what to hand to store().
+	bool lookup(const CSLMatchParams_t& inParams, const std::string& inKey, Result_t& outResult, unsigned& outGeneration);
+	void store(const CSLMatchParams_t& inParams, const std::string& inKey, const Result_t& inResult, unsigned inGeneration);
+
+	void invalidate() { ++mGeneration; }
+
+	void stats(size_t& outEntries, size_t& outCapacity, size_t& outHits, size_t& outMisses);
+
+private:
+	typedef std::pair<std::string, Result_t>	Entry_t;
+
+	// drops everything if the generation or aircraft count moved on
+	void sync(const CSLMatchParams_t& inParams);
+
+	std::mutex											mLock;
+	std::atomic<unsigned>								mGeneration{ 1 };
+	unsigned											mFilledGeneration = 0;
+	int													mAircraftCount = -1;
+	std::list<Entry_t>									mLRU;		// most recent first
+	std::unordered_map<std::string, std::list<Entry_t>::iterator>	mEntries;
+	size_t												mCapacity = 0;
+	size_t												mHits = 0;
+	size_t												mMisses = 0;
+};
+
+extern MatchCache		gMatchCache;
+
+#endif /* XPMPMATCHCACHE_H */
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "XPMPMatchIndex.h"
+
+#include <algorithm>
+#include <cctype>
+
+CSLMatchIndex		gMatchIndex;
+
+size_t CSLMatchIndex::slotOf(CSLMatchKey inKey, size_t inMask)
+{
+	// the atoms are small consecutive numbers - mix them all into the low bits
+	inKey ^= inKey >> 33;
+	inKey *= 0xff51afd7ed558ccdULL;
+	inKey ^= inKey >> 33;
+	return static_cast<size_t>(inKey) & inMask;
+}
+
+static std::string	upper(const char * inText)
+{
+	std::string s(inText);
+	for (char& c : s)
+		c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+	return s;
+}
+
+void CSLMatchIndex::addPackage(CSLPackage_t& inPackage)
+{
+	for (CSLPlane_t& model : inPackage.planes)
+	{
+		auto i = mNames.emplace(upper(model.modelName.c_str()), Named_t{ &model, &model });
+		// an earlier package's model of the same name is replaced, one of this package isn't
+		CSLPlane_t *& last = i.first->second.last;
+		if (!i.second && (last < &inPackage.planes.front() || last > &inPackage.planes.back()))
+			last = &model;
+	}
+
+	for (int n = 0; n < match_count; ++n)
+		for (const auto& m : inPackage.matches[n])
+		{
+			CSLPlane_t& model = inPackage.planes[m.second];
+			if (model.plane_type == plane_Obj && model.obj_idx == -1)
+				continue;
+			insert(mLevels[n], m.first, &model);
+		}
+}
+
+// What the fallback passes compare besides the category.  1 = full equipment code ("L2P"),
+// 2 = engine count and type ("2P"), 3 = engine count, 4 = engine type, 5 = nothing.
+static const int	kFallbackCriteria[] =	{ 1, 2, 1, 2, 3, 4, 3, 4, 5, 5 };
+static const bool	kFallbackAirline[] =	{ true, true, false, false, true, true, false, false, true, false };
+static const char *	kFallbackNames[] = {
+	"airline, WTC and configuration",
+	"airline, WTC, #engines and enginetype",
+	"WTC and configuration",
+	"WTC, #engines and enginetype",
+	"airline, WTC, #engines",
+	"airline, WTC, enginetype",
+	"WTC, #engines",
+	"WTC, enginetype",
+	"airline, WTC",
+	"WTC"
+};
+
+bool CSLMatchIndex::fallbackUsesAirline(int inPass)
+{
+	return kFallbackAirline[inPass - 1];
+}
+
+const char * CSLMatchIndex::fallbackName(int inPass)
+{
+	return kFallbackNames[inPass - 1];
+}
+
+bool CSLMatchIndex::fallbackKey(int inPass, const CSLAircraftCode_t& inCode, const CSLAtom_t& inAirline, CSLMatchKey& outKey)
+{
+	const int criteria = kFallbackCriteria[inPass - 1];
+	// all but the last need a valid equipment code
+	if (criteria < 5 && inCode.equip.length() != 3)
+		return false;
+
+	// category and up to three equipment characters in the top bytes, the airline below
+	uint64_t equip = 0;
+	switch (criteria) {
+	case 1: equip = (uint64_t(uint8_t(inCode.equip[0])) << 16) | (uint64_t(uint8_t(inCode.equip[1])) << 8) | uint8_t(inCode.equip[2]); break;
+	case 2: equip = (uint64_t(uint8_t(inCode.equip[1])) << 8) | uint8_t(inCode.equip[2]); break;
+	case 3: equip = uint8_t(inCode.equip[1]); break;
+	case 4: equip = uint8_t(inCode.equip[2]); break;
+	}
+	outKey = (uint64_t(uint8_t(inCode.category)) << 56) | (equip << 32);
+	if (kFallbackAirline[inPass - 1])
+		outKey |= inAirline.id;
+	return true;
+}
+
+void CSLMatchIndex::rebuildFallback(std::deque<CSLPackage_t>& inPackages, const std::map<std::string, CSLAircraftCode_t>& inCodes)
+{
+	CSLMatchKey key;
+	for (int pass = 1; pass <= kFallbackPasses; ++pass)
+	{
+		Level_t& level = mFallback[pass - 1];
+		level = Level_t();
+		const bool withAirline = kFallbackAirline[pass - 1];
+		for (CSLPackage_t& package : inPackages)
+		{
+			// The matcher takes a bucket's first model, so fill it in the order of the key
+			// text ("B738 SWA") - the atom ids the map is ordered by depend on load order.
+			const auto& matches = package.matches[withAirline ? match_icao_airline : match_icao];
+			std::vector<std::pair<std::string, const std::pair<const CSLMatchKey, int> *>> ordered;
+			ordered.reserve(matches.size());
+			for (const auto& m : matches)
+				ordered.emplace_back(CSL_MatchKeyString(m.first), &m);
+			std::sort(ordered.begin(), ordered.end());		// the texts are unique
+
+			for (const auto& o : ordered)
+			{
+				const auto& m = *o.second;
+				CSLPlane_t& model = package.planes[m.second];
+				if (model.plane_type == plane_Obj && model.obj_idx == -1)
+					continue;
+				// the keys are ICAO or ICAO and airline
+				auto code = inCodes.find(CSL_MatchKeyPart(m.first, 0).c_str());
+				if (code == inCodes.end())
+					continue;
+				if (fallbackKey(pass, code->second, CSL_MatchKeyPart(m.first, 1), key))
+					insert(level, key, &model);
+			}
+		}
+	}
+}
+
+const std::vector<CSLPlane_t *> * CSLMatchIndex::findFallback(int inPass, CSLMatchKey inKey) const
+{
+	return find(mFallback[inPass - 1], inKey);
+}
+
+const std::vector<CSLPlane_t *> * CSLMatchIndex::find(int inLevel, CSLMatchKey inKey) const
+{
+	return find(mLevels[inLevel], inKey);
+}
+
+const std::vector<CSLPlane_t *> * CSLMatchIndex::find(const Level_t& inLevel, CSLMatchKey inKey)
+{
+	if (inLevel.slots.empty())
+		return nullptr;
+	const size_t mask = inLevel.slots.size() - 1;
+	for (size_t i = slotOf(inKey, mask); inLevel.slots[i] != 0; i = (i + 1) & mask)
+		if (inLevel.keys[i] == inKey)
+			return &inLevel.entries[inLevel.slots[i] - 1].models;
+	return nullptr;
+}
+
+void CSLMatchIndex::insert(Level_t& ioLevel, CSLMatchKey inKey, CSLPlane_t * inModel)
+{
+	if ((ioLevel.entries.size() + 1) * 2 > ioLevel.slots.size())
+		grow(ioLevel);
+
+	const size_t mask = ioLevel.slots.size() - 1;
+	size_t i = slotOf(inKey, mask);
+	for (; ioLevel.slots[i] != 0; i = (i + 1) & mask)
+		if (ioLevel.keys[i] == inKey)
+		{
+			ioLevel.entries[ioLevel.slots[i] - 1].models.push_back(inModel);
+			return;
+		}
+	ioLevel.entries.push_back({ inKey, { inModel } });
+	ioLevel.slots[i] = static_cast<uint32_t>(ioLevel.entries.size());
+	ioLevel.keys[i] = inKey;
+}
+
+void CSLMatchIndex::grow(Level_t& ioLevel)
+{
+	const size_t cap = ioLevel.slots.empty() ? 64 : ioLevel.slots.size() * 2;
+	ioLevel.slots.assign(cap, 0);
+	ioLevel.keys.assign(cap, 0);
+	const size_t mask = cap - 1;
+	for (size_t e = 0; e < ioLevel.entries.size(); ++e)
+	{
+		size_t i = slotOf(ioLevel.entries[e].key, mask);
+		while (ioLevel.slots[i] != 0)
+			i = (i + 1) & mask;
+		ioLevel.slots[i] = static_cast<uint32_t>(e + 1);
+		ioLevel.keys[i] = ioLevel.entries[e].key;
+	}
+}
+
+CSLPlane_t * CSLMatchIndex::findByName(const char * inName) const
+{
+	auto i = mNames.find(upper(inName));
+	return i == mNames.end() ? nullptr : i->second.last;
+}
+
+CSLPlane_t * CSLMatchIndex::findFirstByName(const char * inName) const
+{
+	auto i = mNames.find(upper(inName));
+	return i == mNames.end() ? nullptr : i->second.first;
+}
+
+void CSLMatchIndex::clear()
+{
+	mNames.clear();
+	for (Level_t& level : mLevels)
+		level = Level_t();
+	for (Level_t& level : mFallback)
+		level = Level_t();
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef XPMPMATCHINDEX_H
+#define XPMPMATCHINDEX_H
+
+/*
+ * XPMPMatchIndex
+ *
+ * All packages' match keys merged into one table per match level, so a lookup costs one
+ * probe instead of one map search per package.  Keys are CSL_MatchKey integers.  For each key we keep the models that
+ * answer to it, one per package in package order - the order CSL_MatchPlane used to try
+ * them in.  Models that can never be drawn (OBJ7 models that didn't load) are left out
+ * up front; whether an Austin model is loaded depends on the sim's aircraft count, so
+ * that is still checked when matching.
+ *
+ * Packages are only ever appended, so is the index: CSL_LoadCSL adds each new package
+ * under gCSLIndexLock.
+ *
+ * When nothing matches, CSL_MatchPlane falls back to any model of the same wake
+ * turbulence category and similar equipment (doc 8643), in ten passes from strict to
+ * loose.  For these we keep one more table per pass, keyed by what that pass compares
+ * - e.g. M, 2 and J for category, engine count and type, plus the airline's atom in the
+ * passes that want it.  These depend on gAircraftCodes, which every CSL_LoadCSL reloads, so
+ * they are rebuilt from all packages each time.
+ *
+ * Finally the models by name (CSLPlane_t::modelName), ignoring case, for
+ * XPMPCreatePlaneWithModelName and the vertical offset calls.  If packages share a name
+ * the one loaded last wins; within a package the first one.
+ *
+ */
+
+#include "XPMPMultiplayerVars.h"
+
+#include <deque>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class CSLMatchIndex {
+
+public:
+	void addPackage(CSLPackage_t& inPackage);
+
+	// Candidates for inKey at match level inLevel, best first - NULL if none.
+	const std::vector<CSLPlane_t *> * find(int inLevel, CSLMatchKey inKey) const;
+
+	// The fallback passes, 1 to kFallbackPasses.
+	enum { kFallbackPasses = 10 };
+	static bool fallbackUsesAirline(int inPass);
+	static const char * fallbackName(int inPass);
+
+	// The key inCode (and inAirline) have in the fallback pass - false if it takes no part.
+	static bool fallbackKey(int inPass, const CSLAircraftCode_t& inCode, const CSLAtom_t& inAirline, CSLMatchKey& outKey);
+
+	void rebuildFallback(std::deque<CSLPackage_t>& inPackages, const std::map<std::string, CSLAircraftCode_t>& inCodes);
+
+	const std::vector<CSLPlane_t *> * findFallback(int inPass, CSLMatchKey inKey) const;
+
+	// By name, ignoring case; NULL if no model has this name.  If packages share a name
+	// findByName gives the one loaded last (XPMPCreatePlaneWithModelName always did),
+	// findFirstByName the one loaded first (what the vertical offset lookup always did).
+	// Within a package the first model of a name wins either way.
+	CSLPlane_t * findByName(const char * inName) const;
+	CSLPlane_t * findFirstByName(const char * inName) const;
+
+	void clear();
+
+private:
+	struct Entry_t {
+		CSLMatchKey					key;
+		std::vector<CSLPlane_t *>	models;
+	};
+
+	// Open addressing with linear probing; a slot holds entry index + 1, 0 if free.
+	struct Level_t {
+		std::vector<Entry_t>		entries;
+		std::vector<uint32_t>		slots;
+		std::vector<CSLMatchKey>	keys;		// next to slots so lookups never touch entries
+	};
+
+	static size_t slotOf(CSLMatchKey inKey, size_t inMask);
+	static void insert(Level_t& ioLevel, CSLMatchKey inKey, CSLPlane_t * inModel);
+	static void grow(Level_t& ioLevel);
+
+	static const std::vector<CSLPlane_t *> * find(const Level_t& inLevel, CSLMatchKey inKey);
+
+	Level_t							mLevels[match_count];
+	Level_t							mFallback[kFallbackPasses];
+	struct Named_t {
+		CSLPlane_t *	first;
+		CSLPlane_t *	last;
+	};
+	std::unordered_map<std::string, Named_t>	mNames;		// upper case
+};
+
+extern CSLMatchIndex	gMatchIndex;
+
+#endif /* XPMPMATCHINDEX_H */
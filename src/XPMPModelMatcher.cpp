@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "XPMPModelMatcher.h"
+
+#include <algorithm>
+#include <iterator>
+#include <shared_mutex>
+
+ModelMatcher		gModelMatcher;
+
+void ModelMatcher::submit(const CSLMatchParams_t& inParams, std::vector<MatchJob_t> && inJobs)
+{
+	if (inJobs.empty())
+		return;
+	std::lock_guard<std::mutex> lock(mLock);
+	Batch_t batch;
+	batch.params = inParams;
+	batch.jobs = std::move(inJobs);
+	mBatches.push_back(std::move(batch));
+	mStop = false;
+	if (!mThread.joinable())
+		mThread = std::thread(&ModelMatcher::run, this);
+	mWake.notify_one();
+}
+
+void ModelMatcher::collect(std::vector<MatchResult_t>& outResults)
+{
+	std::lock_guard<std::mutex> lock(mLock);
+	if (mResults.empty())
+		return;
+	if (outResults.empty())
+		outResults.swap(mResults);
+	else
+	{
+		std::move(mResults.begin(), mResults.end(), std::back_inserter(outResults));
+		mResults.clear();
+	}
+}
+
+void ModelMatcher::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mLock);
+		mStop = true;
+		mBatches.clear();
+	}
+	mWake.notify_one();
+	if (mThread.joinable())
+		mThread.join();
+	mResults.clear();
+}
+
+void ModelMatcher::run()
+{
+	std::unique_lock<std::mutex> lock(mLock);
+	for (;;)
+	{
+		mWake.wait(lock, [this] { return mStop || !mBatches.empty(); });
+		if (mStop)
+			return;
+
+		// Take one job at a time so stop() and submit() never wait on a whole batch.
+		Batch_t & batch = mBatches.front();
+		const CSLMatchParams_t params = batch.params;
+		MatchJob_t job = std::move(batch.jobs[batch.next++]);
+		if (batch.next == batch.jobs.size())
+			mBatches.pop_front();
+		lock.unlock();
+
+		MatchResult_t result;
+		result.plane = job.plane;
+		result.request = job.request;
+		{
+			std::shared_lock<std::shared_timed_mutex> index(gCSLIndexLock);
+			result.model = CSL_MatchPlane(params, job.icao.c_str(), job.airline.c_str(), job.livery.c_str(),
+										  &result.quality, true, &result.log);
+		}
+
+		lock.lock();
+		mResults.push_back(std::move(result));
+	}
+}
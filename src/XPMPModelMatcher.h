@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef XPMPMODELMATCHER_H
+#define XPMPMODELMATCHER_H
+
+/*
+ * XPMPModelMatcher
+ *
+ * Runs CSL_MatchPlane on a worker thread for XPMPCreatePlanes.  The main thread submits
+ * jobs together with the match params it captured, the worker matches them under a shared
+ * gCSLIndexLock - so the index can't change underneath it - and the main thread collects
+ * the results at the next frame boundary.  Results only carry handles; whether the plane
+ * still wants the result is for the main thread to decide (see XPMPPlane_t::matchRequest).
+ *
+ */
+
+#include "XPMPMultiplayerCSL.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct MatchJob_t {
+	XPMPPlaneID				plane = nullptr;
+	unsigned				request = 0;		// plane's matchRequest when submitted
+	std::string				icao;
+	std::string				airline;
+	std::string				livery;
+};
+
+struct MatchResult_t {
+	XPMPPlaneID				plane = nullptr;
+	unsigned				request = 0;
+	CSLPlane_t *			model = nullptr;
+	int						quality = -1;
+	std::string				log;				// for the main thread to write to the log
+};
+
+class ModelMatcher {
+
+public:
+	~ModelMatcher() { stop(); }
+
+	// Queues a batch, starting the worker if needed.
+	void submit(const CSLMatchParams_t& inParams, std::vector<MatchJob_t> && inJobs);
+
+	// Moves everything finished so far into outResults.
+	void collect(std::vector<MatchResult_t>& outResults);
+
+	// Drops unstarted jobs and joins the worker.  Safe to call more than once.
+	void stop();
+
+private:
+	struct Batch_t {
+		CSLMatchParams_t		params;
+		std::vector<MatchJob_t>	jobs;
+		size_t					next = 0;
+	};
+
+	void run();
+
+	std::thread					mThread;
+	std::mutex					mLock;
+	std::condition_variable		mWake;
+	std::deque<Batch_t>			mBatches;
+	std::vector<MatchResult_t>	mResults;
+	bool						mStop = false;
+};
+
+extern ModelMatcher		gModelMatcher;
+
+#endif /* XPMPMODELMATCHER_H */
@@ -26,6 +26,11 @@
 #include "XPMPPlaneRenderer.h"
 #include "XPMPMultiplayerCSL.h"
 #include "XPMPMultiplayerCSLOffset.h"
+#include "XPMPCommandQueue.h"
+#include "XPMPModelMatcher.h"
+#include "XPMPPlaneEvents.h"
+#include "XPMPMatchCache.h"
+#include "XPMPMatchIndex.h"
 #include "XPLMUtilities.h"
 
 #include <algorithm>
@@ -89,9 +94,21 @@
 */
 bool	gHasControlOfAIAircraft = false;
 
+// NULL for a stale handle.
 static	XPMPPlanePtr	XPMPPlaneFromID(
-		XPMPPlaneID 		inID,
-		XPMPPlaneVector::iterator * outIter = nullptr);
+		XPMPPlaneID 		inID);
+
+// Applies what other threads queued through the XPMPQueue* calls, once per cycle.
+static	void			XPMPApplyQueuedCommands(void);
+
+// Tops up the handles XPMPQueueCreatePlane hands out.
+static	void			XPMPRefillReservedHandles(void);
+
+// Gives planes the models XPMPCreatePlanes matched in the background.
+static	void			XPMPApplyModelMatches(void);
+
+// Hands the frame's plane notifications to the notifiers, once per cycle.
+static	void			XPMPDeliverPlaneEvents(void);
 
 // This drawing hook is called once per frame to do the real drawing.
 static	int				XPMPRenderMultiplayerPlanes(
@@ -99,6 +116,13 @@ static	int				XPMPRenderMultiplayerPlanes(
 		int                  inIsBefore,
 		void *               inRefcon);
 
+// This flight loop callback refreshes gPrefs every prefs_refresh_interval seconds.
+static	float			XPMPRefreshPrefs(
+		float                inElapsedSinceLastCall,
+		float                inElapsedTimeSinceLastFlightLoop,
+		int                  inCounter,
+		void *               inRefcon);
+
 // This drawing hook is called twice per frame to control how many planes
 // should be visible.
 static	int				XPMPControlPlaneCount(
@@ -199,6 +223,7 @@ const char * 	XPMPMultiplayerInitLegacyData(
 	gDefaultPlane = inDefaultPlane;
 	gIntPrefsFunc = inIntPrefsFunc;
 	gFloatPrefsFunc = inFloatPrefsFunc;
+	XPMPLoadPrefs();
 
 	// Set up OpenGL for our drawing callbacks
 	OGL_UtilsInit();
@@ -276,6 +301,12 @@ const char * 	XPMPMultiplayerInit(
 {
 	gIntPrefsFunc = inIntPrefsFunc;
 	gFloatPrefsFunc = inFloatPrefsFunc;
+	XPMPLoadPrefs();
+
+	gCommandQueue.queue.init(static_cast<size_t>(XPMP_TMAX(gPrefs.queue_capacity, 2)));
+	gCommandQueue.handles.init(static_cast<size_t>(XPMP_TMAX(gPrefs.queue_create_reserve, 2)));
+	XPMPRefillReservedHandles();
+	XPMPInitCommandQueueDataRefs();
 	//char	myPath[1024];
 	//char	airPath[1024];
 	//char	line[256];
@@ -303,13 +334,42 @@ const char * 	XPMPMultiplayerInit(
 							 xplm_Phase_Airplanes, 0, /* after*/ 0 /* refcon */))
         problem=true;
 
+	// Keep the prefs snapshot fresh, the client may change its ini at runtime.
+	XPLMRegisterFlightLoopCallback(XPMPRefreshPrefs, gPrefs.prefs_refresh_interval, NULL);
+
 	if (problem)		return "There were problems initializing " XPMP_CLIENT_LONGNAME ".  Please examine X-Plane's error.out file for detailed information.";
 	else 				return "";
 }
 
+void XPMPReloadPrefs(void)
+{
+	XPMPLoadPrefs();
+}
+
+float	XPMPRefreshPrefs(
+		float                /*inElapsedSinceLastCall*/,
+		float                /*inElapsedTimeSinceLastFlightLoop*/,
+		int                  /*inCounter*/,
+		void *               /*inRefcon*/)
+{
+	XPMPLoadPrefs();
+	// 0 unschedules us - from then on only XPMPReloadPrefs() refreshes.
+	return gPrefs.prefs_refresh_interval > 0.0f ? gPrefs.prefs_refresh_interval : 0.0f;
+}
+
 void XPMPMultiplayerCleanup(void)
 {
+	XPLMUnregisterFlightLoopCallback(XPMPRefreshPrefs, NULL);
 	XPMPDeinitDefaultPlaneRenderer();
+	gModelMatcher.stop();
+	gPlaneEvents.clear();
+	XPMPDeinitCommandQueueDataRefs();
+	gCommandQueue.queue.deinit();
+	gCommandQueue.handles.deinit();
+	{
+		std::lock_guard<std::mutex> lock(gCommandQueue.orphanLock);
+		gCommandQueue.orphans.clear();
+	}
 	OGLDEBUG(glDebugMessageCallback(NULL, NULL));
 }
 
@@ -325,6 +385,7 @@ const  char * XPMPMultiplayerEnable(void)
 	std::vector<char *>		ptrs;
 	gPlanePaths.push_back("");
 	
+	std::unique_lock<std::shared_timed_mutex> lock(gCSLIndexLock);
 	for (size_t p = 0; p < gPackages.size(); ++p)
 	{
 		for (size_t pp = 0; pp < gPackages[p].planes.size(); ++pp)
@@ -344,6 +405,8 @@ const  char * XPMPMultiplayerEnable(void)
 			}
 		}
 	}
+	lock.unlock();
+	gMatchCache.invalidate();
 	
 	// Copy the list into something that's not permanent, but is needed by the XPLM.
 	for (size_t n = 0; n < gPlanePaths.size(); ++n)
@@ -486,7 +549,7 @@ void XPMPGetModelInfo(int inIndex, const char** outModelName, const char** outIc
 		}
 
 		int positionInPackage =  inIndex - counter;
-		*outModelName = package.planes[positionInPackage].getModelName().c_str();
+		*outModelName = package.planes[positionInPackage].modelName.c_str();
 		*outIcao = package.planes[positionInPackage].icao.c_str();
 		*outAirline = package.planes[positionInPackage].airline.c_str();
 		*outLivery = package.planes[positionInPackage].livery.c_str();
@@ -498,7 +561,8 @@ void XPMPGetModelInfo(int inIndex, const char** outModelName, const char** outIc
  * PLANE OBJECT SUPPORT
  ********************************************************************************/
 
-XPMPPlaneID		XPMPCreatePlane(
+// A plane with everything but its model - touches no globals, so any thread may do this.
+static std::unique_ptr<XPMPPlane_t>	XPMPNewPlane(
 		const char *			inICAOCode,
 		const char *			inAirline,
 		const char *			inLivery,
@@ -511,46 +575,44 @@ XPMPPlaneID		XPMPCreatePlane(
 	plane->airline = inAirline;
 	plane->dataFunc = inDataFunc;
 	plane->ref = inRefcon;
-	plane->model = CSL_MatchPlane(inICAOCode, inAirline, inLivery, &plane->match_quality, true);
-	
+
+	plane->pushDriven = (inDataFunc == nullptr);
 	plane->pos.size = sizeof(plane->pos);
 	plane->surface.size = sizeof(plane->surface);
 	plane->radar.size = sizeof(plane->radar);
 	plane->posAge = plane->radarAge = plane->surfaceAge = -1;
-	gPlanes.push_back(std::move(plane));
-	
-	XPMPPlanePtr planePtr = gPlanes.back().get();
-	for (XPMPPlaneNotifierVector::iterator iter = gObservers.begin(); iter !=
-		 gObservers.end(); ++iter)
-	{
-		iter->first.first(planePtr, xpmp_PlaneNotification_Created, iter->first.second);
-	}
-	return planePtr;
+	return plane;
+}
+
+// inReserved is a handle handed out ahead of time, or NULL.
+static XPMPPlaneID	XPMPAddPlane(std::unique_ptr<XPMPPlane_t> inPlane, XPMPPlaneID inReserved = nullptr)
+{
+	XPMPPlanePtr planePtr = gPlanes.insert(std::move(inPlane), inReserved);
+	if (!planePtr)
+		return nullptr;
+
+	gPlaneEvents.post(planePtr->id, xpmp_PlaneNotification_Created);
+	return planePtr->id;
 }
 
-bool CompareCaseInsensitive(const string &a, const string &b)
+XPMPPlaneID		XPMPCreatePlane(
+		const char *			inICAOCode,
+		const char *			inAirline,
+		const char *			inLivery,
+		XPMPPlaneData_f			inDataFunc,
+		void *					inRefcon)
 {
-	return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char aa, char bb) { return toupper(aa) == toupper(bb); });
+	auto plane = XPMPNewPlane(inICAOCode, inAirline, inLivery, inDataFunc, inRefcon);
+	plane->model = CSL_MatchPlane(inICAOCode, inAirline, inLivery, &plane->match_quality, true);
+	return XPMPAddPlane(std::move(plane));
 }
 
 XPMPPlaneID     XPMPCreatePlaneWithModelName(const char *inModelName, const char *inICAOCode, const char *inAirline, const char *inLivery, XPMPPlaneData_f inDataFunc, void *inRefcon)
 {
-	auto plane = std::make_unique<XPMPPlane_t>();
-	plane->icao = inICAOCode;
-	plane->livery = inLivery;
-	plane->airline = inAirline;
-	plane->dataFunc = inDataFunc;
-	plane->ref = inRefcon;
+	auto plane = XPMPNewPlane(inICAOCode, inAirline, inLivery, inDataFunc, inRefcon);
 
 	// Find the model
-	for (auto &package : gPackages)
-	{
-		auto cslPlane = std::find_if(package.planes.begin(), package.planes.end(), [inModelName](CSLPlane_t p) { return CompareCaseInsensitive(p.getModelName(), inModelName); });
-		if (cslPlane != package.planes.end())
-		{
-			plane->model = &(*cslPlane);
-		}
-	}
+	plane->model = gMatchIndex.findByName(inModelName);
 
 	if (!plane->model)
 	{
@@ -561,32 +623,72 @@ XPMPPlaneID     XPMPCreatePlaneWithModelName(const char *inModelName, const char
 		return XPMPCreatePlane(inICAOCode, inAirline, inLivery, inDataFunc, inRefcon);
 	}
 
-	plane->pos.size = sizeof(plane->pos);
-	plane->surface.size = sizeof(plane->surface);
-	plane->radar.size = sizeof(plane->radar);
-	plane->posAge = plane->radarAge = plane->surfaceAge = -1;
-	gPlanes.push_back(std::move(plane));
+	return XPMPAddPlane(std::move(plane));
+}
+
+void			XPMPCreatePlanes(
+		const XPMPPlaneCreate_t *	inPlanes,
+		size_t						inCount,
+		XPMPPlaneID *				outIDs)
+{
+	const CSLMatchParams_t params = CSL_GetMatchParams();
+	// Everybody flies the default model until the worker is done with them.
+	CSLPlane_t * placeholder = CSL_MatchPlane(params, params.defaultICAO.c_str(), "", "", nullptr, false, nullptr);
 
-	XPMPPlanePtr planePtr = gPlanes.back().get();
-	for (XPMPPlaneNotifierVector::iterator iter = gObservers.begin(); iter !=
-		 gObservers.end(); ++iter)
+	std::vector<MatchJob_t> jobs;
+	jobs.reserve(inCount);
+	for (size_t n = 0; n < inCount; ++n)
 	{
-		iter->first.first(planePtr, xpmp_PlaneNotification_Created, iter->first.second);
+		const XPMPPlaneCreate_t & c = inPlanes[n];
+		auto plane = XPMPNewPlane(c.icao, c.airline, c.livery, c.dataFunc, c.refcon);
+		plane->model = placeholder;
+		plane->match_quality = -1;
+		plane->matchRequest = 1;
+		outIDs[n] = XPMPAddPlane(std::move(plane));
+
+		MatchJob_t job;
+		job.plane = outIDs[n];
+		job.request = 1;
+		job.icao = c.icao;
+		job.airline = c.airline;
+		job.livery = c.livery;
+		jobs.push_back(std::move(job));
 	}
-	return planePtr;
+	gModelMatcher.submit(params, std::move(jobs));
 }
 
 void			XPMPDestroyPlane(XPMPPlaneID inID)
 {
-	XPMPPlaneVector::iterator iter;
-	XPMPPlanePtr plane = XPMPPlaneFromID(inID, &iter);
-
-	for (XPMPPlaneNotifierVector::iterator iter2 = gObservers.begin(); iter2 !=
-		 gObservers.end(); ++iter2)
+	XPMPPlanePtr plane = XPMPPlaneFromID(inID);
+	if (!plane)
 	{
-		iter2->first.first(plane, xpmp_PlaneNotification_Destroyed, iter2->first.second);
+		// stale, or a reserved handle whose plane never came
+		gPlanes.erase(inID);
+		return;
 	}
-	gPlanes.erase(iter);
+
+	gPlaneEvents.post(inID, xpmp_PlaneNotification_Destroyed);
+	XPMPInvalidateRenderPlan();
+	XPMPReleaseTcasSlot(plane);
+	gPlanes.erase(inID);
+}
+
+// Switches the model and tells everybody.
+static void		XPMPSetPlaneModel(XPMPPlanePtr ioPlane, CSLPlane_t * inModel, int inQuality)
+{
+	ioPlane->model = inModel;
+	ioPlane->match_quality = inQuality;
+
+	// we're changing model, we must flush the resource handles so they get reloaded.
+	ioPlane->objHandle = NULL;
+	ioPlane->texHandle = NULL;
+	ioPlane->texLitHandle = NULL;
+	ioPlane->objState = {};
+	ioPlane->texState = {};
+	ioPlane->texLitState = {};
+	XPMPInvalidateRenderPlan();
+
+	gPlaneEvents.post(ioPlane->id, xpmp_PlaneNotification_ModelChanged);
 }
 
 int	XPMPChangePlaneModel(
@@ -596,25 +698,15 @@ int	XPMPChangePlaneModel(
 		const char *			inLivery)
 {
 	XPMPPlanePtr plane = XPMPPlaneFromID(inPlaneID);
+	if (!plane)
+		return -1;
 	plane->icao = inICAOCode;
 	plane->airline = inAirline;
 	plane->livery = inLivery;
-	plane->model = CSL_MatchPlane(inICAOCode, inAirline, inLivery, &plane->match_quality, true);
-
-	// we're changing model, we must flush the resource handles so they get reloaded.
-	plane->objHandle = NULL;
-	plane->texHandle = NULL;
-	plane->texLitHandle = NULL;
-	plane->objState = {};
-	plane->texState = {};
-	plane->texLitState = {};
-
-	for (XPMPPlaneNotifierVector::iterator iter2 = gObservers.begin(); iter2 !=
-		 gObservers.end(); ++iter2)
-	{
-		iter2->first.first(plane, xpmp_PlaneNotification_ModelChanged, iter2->first.second);
-	}
-
+	++plane->matchRequest;
+	int quality = -1;
+	CSLPlane_t * model = CSL_MatchPlane(inICAOCode, inAirline, inLivery, &quality, true);
+	XPMPSetPlaneModel(plane, model, quality);
 	return plane->match_quality;
 }
 
@@ -640,14 +732,14 @@ int     XPMPGetPlaneModelName(
     // get model name if there is a current model, otherwise "(none)"
     if ( plane->model )
     {
-        modelName = plane->model->getModelName();
+        modelName = plane->model->modelName.str();
     
         // if more or less empty use type, airline, file_path
         if (modelName == " ")
             modelName =
-                plane->model->icao + " " +
-                plane->model->airline + " " +
-                plane->model->file_path;
+                plane->model->icao.str() + " " +
+                plane->model->airline.c_str() + " " +
+                plane->model->file_path.c_str();
     }
     
     // copy into outBuffer as much as possible
@@ -663,6 +755,7 @@ void	XPMPSetDefaultPlaneICAO(
 		const char *			inICAO)
 {
 	gDefaultPlane = inICAO;
+	gMatchCache.invalidate();
 }						
 
 long			XPMPCountPlanes(void)
@@ -676,7 +769,7 @@ XPMPPlaneID		XPMPGetNthPlane(
 	if ((index < 0) || (index >= static_cast<long>(gPlanes.size())))
 		return NULL;
 
-	return gPlanes[index].get();
+	return gPlanes.at(index)->id;
 }							
 
 
@@ -686,6 +779,8 @@ void XPMPGetPlaneICAOAndLivery(
 		char *					outLivery)
 {
 	XPMPPlanePtr	plane = XPMPPlaneFromID(inPlane);
+	if (!plane)
+		return;
 
 	if (outICAOCode)
 		strcpy(outICAOCode,plane->icao.c_str());
@@ -710,23 +805,89 @@ void			XPMPUnregisterPlaneNotifierFunc(
 		gObservers.erase(iter);
 }					
 
+void			XPMPRegisterPlaneEventsFunc(
+		XPMPPlaneEventsNotifier_f	inFunc,
+		void *						inRefcon)
+{
+	gEventObservers.push_back(XPMPPlaneEventsNotifierTripple(XPMPPlaneEventsNotifierPair(inFunc, inRefcon), XPLMGetMyID()));
+}
+
+void			XPMPUnregisterPlaneEventsFunc(
+		XPMPPlaneEventsNotifier_f	inFunc,
+		void *						inRefcon)
+{
+	XPMPPlaneEventsNotifierVector::iterator iter = std::find(
+				gEventObservers.begin(), gEventObservers.end(),
+				XPMPPlaneEventsNotifierTripple(XPMPPlaneEventsNotifierPair(inFunc, inRefcon), XPLMGetMyID()));
+	if (iter != gEventObservers.end())
+		gEventObservers.erase(iter);
+}
+
+// Push-driven planes: hand out what was pushed, never call back.
+static XPMPPlaneCallbackResult	XPMPGetPushedData(
+		XPMPPlanePtr				plane,
+		XPMPPlaneDataType			inDataType,
+		int							inAge,
+		const void *				inData,
+		long						inDataSize,
+		void *						outData,
+		int							now)
+{
+	if (!(plane->pushed & inDataType))
+		return xpmpData_Unavailable;
+	long * outSize = static_cast<long *>(outData);
+	memcpy(outData, inData, XPMP_TMIN(*outSize, inDataSize));
+	return inAge == now ? xpmpData_NewData : xpmpData_Unchanged;
+}
+
 XPMPPlaneCallbackResult			XPMPGetPlaneData(
 		XPMPPlaneID					inPlane,
 		XPMPPlaneDataType			inDataType,
 		void *						outData)
 {
 	XPMPPlanePtr	plane = XPMPPlaneFromID(inPlane);
-	
+	if (!plane)
+		return xpmpData_Unavailable;
+	return XPMPFetchPlaneData(plane, inDataType, outData);
+}
+
+XPMPPlaneCallbackResult			XPMPFetchPlaneData(
+		XPMPPlanePtr				plane,
+		XPMPPlaneDataType			inDataType,
+		void *						outData)
+{
 	XPMPPlaneCallbackResult result = xpmpData_Unavailable;
 	
 	int now = XPLMGetCycleNumber();
 
+	if (plane->pushDriven || !plane->dataFunc)
+	{
+		// snapshot planes: work out where they are now, once per cycle
+		if (inDataType == xpmpDataType_Position && !plane->snapshots.empty() && plane->posAge != now)
+		{
+			plane->snapshots.evaluate(XPLMGetElapsedTime() - gPrefs.snapshot_delay,
+									  gPrefs.snapshot_max_extrapolation, plane->pos);
+			plane->posAge = now;
+			plane->pushed |= xpmpDataType_Position;
+		}
+
+		switch(inDataType) {
+		case xpmpDataType_Position:
+			return XPMPGetPushedData(plane, inDataType, plane->posAge, &plane->pos, plane->pos.size, outData, now);
+		case xpmpDataType_Surfaces:
+			return XPMPGetPushedData(plane, inDataType, plane->surfaceAge, &plane->surface, plane->surface.size, outData, now);
+		case xpmpDataType_Radar:
+			return XPMPGetPushedData(plane, inDataType, plane->radarAge, &plane->radar, plane->radar.size, outData, now);
+		}
+		return result;
+	}
+
 	switch(inDataType) {
 	case xpmpDataType_Position:
 	{
 		if (plane->posAge != now)
 		{
-			result = plane->dataFunc(plane, inDataType, &plane->pos, plane->ref);
+			result = plane->dataFunc(plane->id, inDataType, &plane->pos, plane->ref);
 			if (result == xpmpData_NewData)
 				plane->posAge = now;
 		}
@@ -741,7 +902,7 @@ XPMPPlaneCallbackResult			XPMPGetPlaneData(
 	{
 		if (plane->surfaceAge != now)
 		{
-			result = plane->dataFunc(plane, inDataType, &plane->surface, plane->ref);
+			result = plane->dataFunc(plane->id, inDataType, &plane->surface, plane->ref);
 			if (result == xpmpData_NewData)
 				plane->surfaceAge = now;
 		}
@@ -756,7 +917,7 @@ XPMPPlaneCallbackResult			XPMPGetPlaneData(
 	{
 		if (plane->radarAge != now)
 		{
-			result = plane->dataFunc(plane, inDataType, &plane->radar, plane->ref);
+			result = plane->dataFunc(plane->id, inDataType, &plane->radar, plane->ref);
 			if (result == xpmpData_NewData)
 				plane->radarAge = now;
 		}
@@ -771,18 +932,340 @@ XPMPPlaneCallbackResult			XPMPGetPlaneData(
 	return result;
 }
 
-XPMPPlanePtr	XPMPPlaneFromID(XPMPPlaneID inID, XPMPPlaneVector::iterator * outIter)
+// Our structs keep their own size - the client's may be older (smaller).
+template <class T>
+static void XPMPCopyPushedData(T & ioDst, const T * inSrc)
+{
+	const long mySize = ioDst.size;
+	memcpy(&ioDst, inSrc, XPMP_TMIN(inSrc->size, mySize));
+	ioDst.size = mySize;
+}
+
+void			XPMPPushPlaneSnapshots(
+		XPMPPlaneID					inPlane,
+		const XPMPPlaneSnapshot_t *	inSnapshots,
+		size_t						inCount)
+{
+	XPMPPlanePtr plane = XPMPPlaneFromID(inPlane);
+	if (!plane)
+		return;
+	plane->pushDriven = true;
+	for (size_t n = 0; n < inCount; ++n)
+		plane->snapshots.push(inSnapshots[n]);
+	// make the next query evaluate again
+	plane->posAge = -1;
+}
+
+void			XPMPUpdatePlanes(
+		const XPMPPlaneUpdate_t *	inUpdates,
+		size_t						inCount)
+{
+	int now = XPLMGetCycleNumber();
+	for (size_t n = 0; n < inCount; ++n)
+	{
+		const XPMPPlaneUpdate_t & u = inUpdates[n];
+		XPMPPlanePtr plane = XPMPPlaneFromID(u.plane);
+		if (!plane)
+			continue;
+		plane->pushDriven = true;
+
+		if (u.position)
+		{
+			XPMPCopyPushedData(plane->pos, u.position);
+			plane->posAge = now;
+			plane->pushed |= xpmpDataType_Position;
+		}
+		if (u.surfaces)
+		{
+			XPMPCopyPushedData(plane->surface, u.surfaces);
+			plane->surfaceAge = now;
+			plane->pushed |= xpmpDataType_Surfaces;
+		}
+		if (u.radar)
+		{
+			XPMPCopyPushedData(plane->radar, u.radar);
+			plane->radarAge = now;
+			plane->pushed |= xpmpDataType_Radar;
+		}
+	}
+}
+
+/********************************************************************************
+ * QUEUED PLANE API
+ ********************************************************************************/
+
+static bool		XPMPQueueCommand(XPMPCommand_t && ioCommand)
+{
+	if (gCommandQueue.queue.ready() && gCommandQueue.queue.push(std::move(ioCommand)))
+		return true;
+	gCommandQueue.dropped.fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
+
+XPMPPlaneID		XPMPQueueCreatePlane(
+		const char *			inICAOCode,
+		const char *			inAirline,
+		const char *			inLivery,
+		XPMPPlaneData_f			inDataFunc,
+		void *					inRefcon)
+{
+	XPMPCommand_t cmd;
+	cmd.type = xpmpCmd_Create;
+	if (!gCommandQueue.handles.ready() || !gCommandQueue.handles.pop(cmd.plane))
+	{
+		// more creates this frame than we have handles ready
+		gCommandQueue.dropped.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+	cmd.icao = inICAOCode;
+	cmd.airline = inAirline;
+	cmd.livery = inLivery;
+	cmd.dataFunc = inDataFunc;
+	cmd.ref = inRefcon;
+	XPMPPlaneID id = cmd.plane;
+	if (XPMPQueueCommand(std::move(cmd)))
+		return id;
+	// hand the handle back - or, should the main thread have refilled meanwhile, have
+	// it drop the reservation
+	if (!gCommandQueue.handles.push(XPMPPlaneID(id)))
+	{
+		std::lock_guard<std::mutex> lock(gCommandQueue.orphanLock);
+		gCommandQueue.orphans.push_back(id);
+	}
+	return nullptr;
+}
+
+int				XPMPQueueDestroyPlane(
+		XPMPPlaneID				inPlaneID)
 {
-	assert(inID);
-	if (outIter)
+	XPMPCommand_t cmd;
+	cmd.type = xpmpCmd_Destroy;
+	cmd.plane = inPlaneID;
+	return XPMPQueueCommand(std::move(cmd)) ? 1 : 0;
+}
+
+int				XPMPQueueChangePlaneModel(
+		XPMPPlaneID				inPlaneID,
+		const char *			inICAOCode,
+		const char *			inAirline,
+		const char *			inLivery)
+{
+	XPMPCommand_t cmd;
+	cmd.type = xpmpCmd_ChangeModel;
+	cmd.plane = inPlaneID;
+	cmd.icao = inICAOCode;
+	cmd.airline = inAirline;
+	cmd.livery = inLivery;
+	return XPMPQueueCommand(std::move(cmd)) ? 1 : 0;
+}
+
+size_t			XPMPQueueUpdatePlanes(
+		const XPMPPlaneUpdate_t *	inUpdates,
+		size_t						inCount)
+{
+	for (size_t n = 0; n < inCount; ++n)
 	{
-		*outIter = std::find_if(gPlanes.begin(), gPlanes.end(), [inID] (const auto &p)
+		const XPMPPlaneUpdate_t & u = inUpdates[n];
+		XPMPCommand_t cmd;
+		cmd.type = xpmpCmd_Update;
+		cmd.plane = u.plane;
+		cmd.pos.size = sizeof(cmd.pos);
+		cmd.surface.size = sizeof(cmd.surface);
+		cmd.radar.size = sizeof(cmd.radar);
+		if (u.position)
+		{
+			XPMPCopyPushedData(cmd.pos, u.position);
+			cmd.dataMask |= xpmpDataType_Position;
+		}
+		if (u.surfaces)
 		{
-			return p.get() == inID;
-		});
-		assert(*outIter != gPlanes.end());
+			XPMPCopyPushedData(cmd.surface, u.surfaces);
+			cmd.dataMask |= xpmpDataType_Surfaces;
+		}
+		if (u.radar)
+		{
+			XPMPCopyPushedData(cmd.radar, u.radar);
+			cmd.dataMask |= xpmpDataType_Radar;
+		}
+		if (!XPMPQueueCommand(std::move(cmd)))
+			return n;
 	}
-	return static_cast<XPMPPlanePtr>(inID);
+	return inCount;
+}
+
+size_t			XPMPQueuePlaneSnapshots(
+		XPMPPlaneID					inPlane,
+		const XPMPPlaneSnapshot_t *	inSnapshots,
+		size_t						inCount)
+{
+	for (size_t n = 0; n < inCount; ++n)
+	{
+		XPMPCommand_t cmd;
+		cmd.type = xpmpCmd_Snapshot;
+		cmd.plane = inPlane;
+		cmd.snapshot = inSnapshots[n];
+		if (!XPMPQueueCommand(std::move(cmd)))
+			return n;
+	}
+	return inCount;
+}
+
+void			XPMPGetQueueStats(
+		XPMPQueueStats_t *			outStats)
+{
+	XPMPQueueStats_t stats;
+	stats.size = sizeof(stats);
+	stats.capacity = gCommandQueue.queue.capacity();
+	stats.depth = gCommandQueue.queue.depth();
+	stats.maxDepth = gCommandQueue.maxDepth.load(std::memory_order_relaxed);
+	stats.dropped = gCommandQueue.dropped.load(std::memory_order_relaxed);
+	stats.applied = gCommandQueue.applied.load(std::memory_order_relaxed);
+	stats.appliedLastFrame = gCommandQueue.appliedLastFrame.load(std::memory_order_relaxed);
+
+	long size = outStats->size;
+	if (size <= 0 || size > static_cast<long>(sizeof(stats)))
+		size = sizeof(stats);
+	memcpy(outStats, &stats, size);
+	outStats->size = size;
+}
+
+static void		XPMPApplyCommand(XPMPCommand_t & ioCommand)
+{
+	switch (ioCommand.type) {
+	case xpmpCmd_Create:
+	{
+		auto plane = XPMPNewPlane(ioCommand.icao.c_str(), ioCommand.airline.c_str(), ioCommand.livery.c_str(),
+								  ioCommand.dataFunc, ioCommand.ref);
+		plane->model = CSL_MatchPlane(ioCommand.icao.c_str(), ioCommand.airline.c_str(), ioCommand.livery.c_str(),
+									  &plane->match_quality, true);
+		XPMPAddPlane(std::move(plane), ioCommand.plane);
+		break;
+	}
+	case xpmpCmd_Destroy:
+		XPMPDestroyPlane(ioCommand.plane);
+		break;
+	case xpmpCmd_ChangeModel:
+		XPMPChangePlaneModel(ioCommand.plane, ioCommand.icao.c_str(), ioCommand.airline.c_str(),
+							 ioCommand.livery.c_str());
+		break;
+	case xpmpCmd_Update:
+	{
+		XPMPPlaneUpdate_t u;
+		u.size = sizeof(u);
+		u.plane = ioCommand.plane;
+		u.position = (ioCommand.dataMask & xpmpDataType_Position) ? &ioCommand.pos : nullptr;
+		u.surfaces = (ioCommand.dataMask & xpmpDataType_Surfaces) ? &ioCommand.surface : nullptr;
+		u.radar = (ioCommand.dataMask & xpmpDataType_Radar) ? &ioCommand.radar : nullptr;
+		XPMPUpdatePlanes(&u, 1);
+		break;
+	}
+	case xpmpCmd_Snapshot:
+		XPMPPushPlaneSnapshots(ioCommand.plane, &ioCommand.snapshot, 1);
+		break;
+	default:
+		break;
+	}
+}
+
+void			XPMPApplyQueuedCommands(void)
+{
+	XPMPCommandQueue_t & q = gCommandQueue;
+	if (!q.queue.ready())
+		return;
+	// we're called for every drawing pass - apply once a frame
+	const int cycle = XPLMGetCycleNumber();
+	if (cycle == q.lastCycle)
+		return;
+	q.lastCycle = cycle;
+
+	q.maxDepth.store(XPMP_TMAX(q.maxDepth.load(std::memory_order_relaxed), q.queue.depth()), std::memory_order_relaxed);
+	const size_t limit = gPrefs.queue_commands_per_frame > 0 ?
+		static_cast<size_t>(gPrefs.queue_commands_per_frame) : q.queue.capacity();
+	size_t n = 0;
+	XPMPCommand_t cmd;
+	while (n < limit && q.queue.pop(cmd))
+	{
+		XPMPApplyCommand(cmd);
+		++n;
+	}
+	q.appliedLastFrame.store(n, std::memory_order_relaxed);
+	q.applied.fetch_add(n, std::memory_order_relaxed);
+
+	XPMPRefillReservedHandles();
+}
+
+void			XPMPRefillReservedHandles(void)
+{
+	BoundedQueue<XPMPPlaneID> & handles = gCommandQueue.handles;
+	if (!handles.ready())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(gCommandQueue.orphanLock);
+		for (XPMPPlaneID id : gCommandQueue.orphans)
+			gPlanes.erase(id);
+		gCommandQueue.orphans.clear();
+	}
+	while (handles.depth() < handles.capacity())
+	{
+		XPMPPlaneID id = gPlanes.reserve();
+		if (!handles.push(std::move(id)))
+		{
+			gPlanes.erase(id);
+			break;
+		}
+	}
+}
+
+void			XPMPApplyModelMatches(void)
+{
+	// we're called for every drawing pass - a new model mid-frame would rebuild the plan
+	// and could draw a plane in two passes or none, so only at the start of a frame
+	static int lastCycle = -1;
+	const int cycle = XPLMGetCycleNumber();
+	if (cycle == lastCycle)
+		return;
+	lastCycle = cycle;
+
+	static std::vector<MatchResult_t> results;
+	results.clear();
+	gModelMatcher.collect(results);
+	for (MatchResult_t & r : results)
+	{
+		if (!r.log.empty())
+			XPLMDebugString(r.log.c_str());
+		XPMPPlanePtr plane = XPMPPlaneFromID(r.plane);
+		// destroyed, or its model was changed since we asked
+		if (!plane || plane->matchRequest != r.request)
+			continue;
+		XPMPSetPlaneModel(plane, r.model, r.quality);
+	}
+}
+
+void			XPMPDeliverPlaneEvents(void)
+{
+	static int lastCycle = -1;
+	const int cycle = XPLMGetCycleNumber();
+	if (cycle == lastCycle || gPlaneEvents.empty())
+		return;
+	lastCycle = cycle;
+
+	// Notifiers may create, destroy or unregister while we're at it - whatever they
+	// cause is delivered next frame, and we work on copies.
+	std::vector<XPMPPlaneEvent_t> events;
+	gPlaneEvents.take(events);
+	const XPMPPlaneNotifierVector observers(gObservers);
+	const XPMPPlaneEventsNotifierVector eventObservers(gEventObservers);
+
+	for (const XPMPPlaneEventsNotifierTripple & o : eventObservers)
+		o.first.first(events.data(), events.size(), o.first.second);
+	for (const XPMPPlaneEvent_t & e : events)
+		for (const XPMPPlaneNotifierTripple & o : observers)
+			o.first.first(e.plane, e.notification, o.first.second);
+}
+
+XPMPPlanePtr	XPMPPlaneFromID(XPMPPlaneID inID)
+{
+	return gPlanes.find(inID);
 }
 
 void		XPMPSetPlaneRenderer(
@@ -827,6 +1310,10 @@ int	XPMPRenderMultiplayerPlanes(
 		void *               /*inRefcon*/)
 {
 	static int is_blend = 0;
+
+	XPMPApplyQueuedCommands();
+	XPMPApplyModelMatches();
+	XPMPDeliverPlaneEvents();
 	
 	static XPLMDataRef wrt = XPLMFindDataRef("sim/graphics/view/world_render_type");
 	static XPLMDataRef prt = XPLMFindDataRef("sim/graphics/view/plane_render_type");
@@ -855,6 +1342,8 @@ int 		XPMPGetPlaneModelQuality(
 		XPMPPlaneID 				inPlane)
 {
 	XPMPPlanePtr thisPlane = XPMPPlaneFromID(inPlane);
+	if (!thisPlane)
+		return -1;
 
 	return thisPlane->match_quality;
 }
@@ -870,6 +1359,20 @@ int			XPMPModelMatchQuality(
 	return matchQuality;
 }
 
+void		XPMPGetMatchCacheStats(
+		XPMPMatchCacheStats_t *		outStats)
+{
+	XPMPMatchCacheStats_t stats;
+	stats.size = sizeof(stats);
+	gMatchCache.stats(stats.entries, stats.capacity, stats.hits, stats.misses);
+
+	long size = outStats->size;
+	if (size <= 0 || size > static_cast<long>(sizeof(stats)))
+		size = sizeof(stats);
+	memcpy(outStats, &stats, size);
+	outStats->size = size;
+}
+
 void		XPMPDumpOneCycle(void)
 {
 	CSL_Dump();
@@ -23,6 +23,9 @@
 
 #include "XPMPMultiplayerCSL.h"
 #include "XPMPMultiplayerCSLOffset.h"
+#include "XPMPMatchIndex.h"
+#include "XPMPMatchCache.h"
+#include "XPMPCatalogCache.h"
 #include "XPLMUtilities.h"
 #include "XPMPMultiplayerObj.h"
 #include "XStringUtils.h"
@@ -37,6 +40,8 @@
 #include <sstream>
 #include <functional>
 #include <cctype>
+#include <atomic>
+#include <thread>
 
 using std::max;
 
@@ -57,6 +62,33 @@ enum {
 	pass_Count
 };
 
+// The related.txt group of an ICAO, empty if it has none.
+static CSLAtom_t	CSL_GroupOf(const CSLAtom_t& inICAO)
+{
+	auto i = gGroupings.find(inICAO.id);
+	return i == gGroupings.end() ? CSLAtom_t() : i->second;
+}
+
+// Packages are parsed on worker threads, which must not call the XPLM.  While a worker
+// parses, diagnostics collect in its package's log; the main thread writes them out
+// in package order once all are done.
+static thread_local std::string *	sParseLog = nullptr;
+
+static void	csl_log(const char * inText)
+{
+	if (sParseLog)
+		sParseLog->append(inText);
+	else
+		XPLMDebugString(inText);
+}
+
+// Asked of the sim once per load, before the workers start.
+static int			sSimVersion = 0;
+static std::string	sSystemPath;
+
+// In the CSL folder - see XPMPCatalogCache.h
+static const char	kCatalogCacheFile[] = "xpmp_catalog.cache";
+
 // count repeating message to limit filling up Log.txt
 // (This often happens when people use packages intended for X-IvAp, PE, or from X-CSL.)
 enum msgCntE {
@@ -83,7 +115,10 @@ struct MsgCntTy {
     inline bool showAfterInc (msgCntE e) { return ++(cnt[e]) <= MSG_MAX_NUM; }
     
     void DumpResults(const char* fileName);
-} MsgCnt;
+};
+
+// per thread - each parse worker counts for the package it is on
+static thread_local MsgCntTy MsgCnt;
 
 // Tell user how many message we suppressed during parsing
 void MsgCntTy::DumpResults (const char* fileName)
@@ -96,20 +131,20 @@ void MsgCntTy::DumpResults (const char* fileName)
             if (!bFileShown) {
                 snprintf(buf, sizeof(buf), XPMP_CLIENT_NAME " --- Parsing '%s':\n",
                          fileName);
-                XPLMDebugString(buf);
+                csl_log(buf);
                 bFileShown = true;
             }
             // output number of suppressed messages
             snprintf(buf, sizeof(buf), XPMP_CLIENT_NAME ": Following message suppresed %d time(s): %s\n",
                      cnt[e], MSG_SUPPRESED_TXT[e]);
-            XPLMDebugString(buf);
+            csl_log(buf);
         }
         cnt[e] = 0;                 // reset counter once reported
     }
     
     // to ease reading Log.txt we add an empty line if we output anything
     if (bFileShown)
-        XPLMDebugString(XPMP_CLIENT_NAME " ---\n");
+        csl_log(XPMP_CLIENT_NAME " ---\n");
 }
 
 /************************************************************************
@@ -206,47 +241,47 @@ struct XPLMDump {
 	XPLMDump() { }
 	
 	XPLMDump(const string& inFileName, int lineNum, const char * line) {
-		XPLMDebugString(XPMP_CLIENT_NAME " WARNING: Parse Error in file ");
-		XPLMDebugString(inFileName.c_str());
-		XPLMDebugString(" line ");
+		csl_log(XPMP_CLIENT_NAME " WARNING: Parse Error in file ");
+		csl_log(inFileName.c_str());
+		csl_log(" line ");
 		char buf[32];
 		sprintf(buf,"%d", lineNum);
-		XPLMDebugString(buf);
-		XPLMDebugString(".\n              ");
-		XPLMDebugString(line);
-		XPLMDebugString(".\n");
+		csl_log(buf);
+		csl_log(".\n              ");
+		csl_log(line);
+		csl_log(".\n");
 	}
 
 	XPLMDump(const string& inFileName, int lineNum, const string& line) {
-		XPLMDebugString(XPMP_CLIENT_NAME " WARNING: Parse Error in file ");
-		XPLMDebugString(inFileName.c_str());
-		XPLMDebugString(" line ");
+		csl_log(XPMP_CLIENT_NAME " WARNING: Parse Error in file ");
+		csl_log(inFileName.c_str());
+		csl_log(" line ");
 		char buf[32];
 		sprintf(buf,"%d", lineNum);
-		XPLMDebugString(buf);
-		XPLMDebugString(".\n              ");
-		XPLMDebugString(line.c_str());
-		XPLMDebugString(".\n");
+		csl_log(buf);
+		csl_log(".\n              ");
+		csl_log(line.c_str());
+		csl_log(".\n");
 	}
 	
 	XPLMDump& operator<<(const char * rhs) {
-		XPLMDebugString(rhs);
+		csl_log(rhs);
 		return *this;
 	}
 	XPLMDump& operator<<(const std::string& rhs) {
-		XPLMDebugString(rhs.c_str());
+		csl_log(rhs.c_str());
 		return *this;
 	}
 	XPLMDump& operator<<(int n) {
 		char buf[255];
 		sprintf(buf, "%d", n);
-		XPLMDebugString(buf);
+		csl_log(buf);
 		return *this;
 	}
 	XPLMDump& operator<<(size_t n) {
 		char buf[255];
 		sprintf(buf, "%u", static_cast<unsigned>(n));
-		XPLMDebugString(buf);
+		csl_log(buf);
 		return *this;
 	}
 };
@@ -443,16 +478,17 @@ bool ParseObjectCommand(const std::vector<std::string> &tokens, CSLPackage_t &pa
 	objFileName.erase(objFileName.find_last_of('.'));
 
 	package.planes.push_back(CSLPlane_t());
-	package.planes.back().dirNames = dirNames;
-	package.planes.back().objectName = objFileName;
+	for (const string& dir : dirNames)
+		package.planes.back().dirNames.push_back(gCSLAtoms.intern(dir));
+	package.planes.back().objectName = gCSLAtoms.intern(objFileName);
 	package.planes.back().plane_type = plane_Obj;
-	package.planes.back().file_path = fullPath;
+	package.planes.back().file_path = gCSLAtoms.intern(fullPath);
 	package.planes.back().moving_gear = true;
-	package.planes.back().textureName = OBJ_DefaultModel(fullPath);
+	package.planes.back().textureName = gCSLAtoms.intern(OBJ_DefaultModel(fullPath));
 #if DEBUG_CSL_LOADING
-	XPLMDebugString("      Got Object: ");
-	XPLMDebugString(fullPath.c_str());
-	XPLMDebugString("\n");
+	csl_log("      Got Object: ");
+	csl_log(fullPath.c_str());
+	csl_log("\n");
 #endif
 
 	return true;
@@ -483,14 +519,14 @@ bool ParseTextureCommand(const std::vector<std::string> &tokens, CSLPackage_t &p
 	// Remove extension if present.
 	textureFilename.erase(textureFilename.find_last_of('.'));
 
-	package.planes.back().textureName = textureFilename;
-	package.planes.back().texturePath = absoluteTexPath;
-	package.planes.back().textureLitPath = OBJ_GetLitTextureByTexture(absoluteTexPath);
+	package.planes.back().textureName = gCSLAtoms.intern(textureFilename);
+	package.planes.back().texturePath = gCSLAtoms.intern(absoluteTexPath);
+	package.planes.back().textureLitPath = gCSLAtoms.intern(OBJ_GetLitTextureByTexture(absoluteTexPath));
 
 #if DEBUG_CSL_LOADING
-	XPLMDebugString("      Got texture: ");
-	XPLMDebugString(absoluteTexPath.c_str());
-	XPLMDebugString("\n");
+	csl_log("      Got texture: ");
+	csl_log(absoluteTexPath.c_str());
+	csl_log("\n");
 #endif
 
 	return true;
@@ -504,11 +540,7 @@ bool ParseAircraftCommand(const std::vector<std::string> &tokens, CSLPackage_t &
 		XPLMDump(path, lineNum, line) << XPMP_CLIENT_NAME " WARNING: AIRCRAFT command takes 3 arguments.\n";
 	}
 
-	int sim, xplm;
-	XPLMHostApplicationID 	host;
-	XPLMGetVersions(&sim, &xplm, &host);
-
-	if (sim >= atoi(tokens[1].c_str()) && sim <= atoi(tokens[2].c_str()))
+	if (sSimVersion >= atoi(tokens[1].c_str()) && sSimVersion <= atoi(tokens[2].c_str()))
 	{
 		string relativePath = tokens[3];
 		MakePartialPathNativeObj(relativePath);
@@ -521,13 +553,13 @@ bool ParseAircraftCommand(const std::vector<std::string> &tokens, CSLPackage_t &
 		package.planes.push_back(CSLPlane_t());
 		//! \todo Fill in acf model name information
 		package.planes.back().plane_type = plane_Austin;
-		package.planes.back().file_path = absolutePath;
+		package.planes.back().file_path = gCSLAtoms.intern(absolutePath);
 		package.planes.back().moving_gear = true;
 		package.planes.back().austin_idx = -1;
 #if DEBUG_CSL_LOADING
-		XPLMDebugString("      Got Airplane: ");
-		XPLMDebugString(absolutePath.c_str());
-		XPLMDebugString("\n");
+		csl_log("      Got Airplane: ");
+		csl_log(absolutePath.c_str());
+		csl_log("\n");
 #endif
 
 	}
@@ -547,18 +579,18 @@ bool ParseObj8AircraftCommand(const std::vector<std::string> &tokens, CSLPackage
 	}
 
 	package.planes.push_back(CSLPlane_t());
-	package.planes.back().dirNames = { package.path.substr(package.path.find_last_of('/') + 1) };
-	package.planes.back().objectName = tokens[1];
+	package.planes.back().dirNames = { gCSLAtoms.intern(package.path.substr(package.path.find_last_of('/') + 1)) };
+	package.planes.back().objectName = gCSLAtoms.intern(tokens[1]);
 	package.planes.back().plane_type = plane_Obj8;
-	package.planes.back().file_path = tokens[1];
+	package.planes.back().file_path = package.planes.back().objectName;
 	package.planes.back().moving_gear = true;
 	package.planes.back().texID = 0;
 	package.planes.back().texLitID = 0;
 	package.planes.back().obj_idx = -1;
 #if DEBUG_CSL_LOADING
-	XPLMDebugString("      Got OBJ8 Airplane: ");
-	XPLMDebugString(tokens[1].c_str());
-	XPLMDebugString("\n");
+	csl_log("      Got OBJ8 Airplane: ");
+	csl_log(tokens[1].c_str());
+	csl_log("\n");
 #endif
 	return true;
 }
@@ -609,15 +641,7 @@ bool ParseObj8Command(const std::vector<std::string> &tokens, CSLPackage_t &pack
 		return false;
 	}
 
-	char xsystem[1024];
-	XPLMGetSystemPath(xsystem);
-
-#if APL
-	if (XPLMIsFeatureEnabled("XPLM_USE_NATIVE_PATHS") == 0)
-		HFS2PosixPath(xsystem, xsystem, 1024);
-#endif
-
-	size_t sys_len = strlen(xsystem);
+	size_t sys_len = sSystemPath.size();
 	if(absolutePath.size() > sys_len)
 		absolutePath.erase(absolutePath.begin(),absolutePath.begin() + sys_len);
 	else
@@ -684,14 +708,13 @@ bool ParseIcaoCommand(const std::vector<std::string> &tokens, CSLPackage_t &pack
 		return false;
 	}
 
-	std::string icao = tokens[1];
+	const CSLAtom_t icao = gCSLAtoms.intern(tokens[1]);
 	package.planes.back().icao = icao;
-	std::string group = gGroupings[icao];
-	if (package.matches[match_icao].count(icao) == 0)
-		package.matches[match_icao]	   [icao] = static_cast<int>(package.planes.size()) - 1;
+	const CSLAtom_t group = CSL_GroupOf(icao);
+	const int index = static_cast<int>(package.planes.size()) - 1;
+	package.matches[match_icao].emplace(CSL_MatchKey(icao), index);
 	if (!group.empty())
-		if (package.matches[match_group].count(group) == 0)
-			package.matches[match_group]      [group] = static_cast<int>(package.planes.size()) - 1;
+		package.matches[match_group].emplace(CSL_MatchKey(group), index);
 
 	return true;
 }
@@ -705,25 +728,22 @@ bool ParseAirlineCommand(const std::vector<std::string> &tokens, CSLPackage_t &p
 		return false;
 	}
 
-	std::string icao = tokens[1];
+	const CSLAtom_t icao = gCSLAtoms.intern(tokens[1]);
 	package.planes.back().icao = icao;
-	std::string airline = tokens[2];
+	const CSLAtom_t airline = gCSLAtoms.intern(tokens[2]);
 	package.planes.back().airline = airline;
-	std::string group = gGroupings[icao];
-	if (package.matches[match_icao_airline].count(icao + " " + airline) == 0)
-		package.matches[match_icao_airline]      [icao + " " + airline] = static_cast<int>(package.planes.size()) - 1;
+	const CSLAtom_t group = CSL_GroupOf(icao);
+	const int index = static_cast<int>(package.planes.size()) - 1;
+	package.matches[match_icao_airline].emplace(CSL_MatchKey(icao, airline), index);
 #if USE_DEFAULTING
-	if (package.matches[match_icao		].count(icao				) == 0)
-		package.matches[match_icao		]      [icao				] = package.planes.size() - 1;
+	package.matches[match_icao].emplace(CSL_MatchKey(icao), index);
 #endif
 	if (!group.empty())
 	{
 #if USE_DEFAULTING
-		if (package.matches[match_group	     ].count(group				  ) == 0)
-			package.matches[match_group	     ]		[group				  ] = package.planes.size() - 1;
+		package.matches[match_group].emplace(CSL_MatchKey(group), index);
 #endif
-		if (package.matches[match_group_airline].count(group + " " + airline) == 0)
-			package.matches[match_group_airline]		[group + " " + airline] = static_cast<int>(package.planes.size()) - 1;
+		package.matches[match_group_airline].emplace(CSL_MatchKey(group, airline), index);
 	}
 
 	return true;
@@ -738,31 +758,26 @@ bool ParseLiveryCommand(const std::vector<std::string> &tokens, CSLPackage_t &pa
 		return false;
 	}
 
-	std::string icao = tokens[1];
+	const CSLAtom_t icao = gCSLAtoms.intern(tokens[1]);
 	package.planes.back().icao = icao;
-	std::string airline = tokens[2];
+	const CSLAtom_t airline = gCSLAtoms.intern(tokens[2]);
 	package.planes.back().airline = airline;
-	std::string livery = tokens[3];
+	const CSLAtom_t livery = gCSLAtoms.intern(tokens[3]);
 	package.planes.back().livery = livery;
-	std::string group = gGroupings[icao];
+	const CSLAtom_t group = CSL_GroupOf(icao);
+	const int index = static_cast<int>(package.planes.size()) - 1;
 #if USE_DEFAULTING
-	if (package.matches[match_icao				].count(icao							   ) == 0)
-		package.matches[match_icao				]	   [icao							   ] = package.planes.size() - 1;
-	if (package.matches[match_icao				].count(icao							   ) == 0)
-		package.matches[match_icao_airline 		]	   [icao + " " + airline			   ] = package.planes.size() - 1;
+	package.matches[match_icao].emplace(CSL_MatchKey(icao), index);
+	package.matches[match_icao_airline].emplace(CSL_MatchKey(icao, airline), index);
 #endif
-	if (package.matches[match_icao_airline_livery ].count(icao + " " + airline + " " + livery) == 0)
-		package.matches[match_icao_airline_livery ]	   [icao + " " + airline + " " + livery] = static_cast<int>(package.planes.size()) - 1;
+	package.matches[match_icao_airline_livery].emplace(CSL_MatchKey(icao, airline, livery), index);
 	if (!group.empty())
 	{
 #if USE_DEFAULTING
-		if (package.matches[match_group		 		 ].count(group							     ) == 0)
-			package.matches[match_group		 		 ]		[group							     ] = package.planes.size() - 1;
-		if (package.matches[match_group_airline		 ].count(group + " " + airline			     ) == 0)
-			package.matches[match_group_airline		 ]		[group + " " + airline			     ] = package.planes.size() - 1;
+		package.matches[match_group].emplace(CSL_MatchKey(group), index);
+		package.matches[match_group_airline].emplace(CSL_MatchKey(group, airline), index);
 #endif
-		if (package.matches[match_group_airline_livery ].count(group + " " + airline + " " + livery) == 0)
-			package.matches[match_group_airline_livery ]		[group + " " + airline + " " + livery] = static_cast<int>(package.planes.size()) - 1;
+		package.matches[match_group_airline_livery].emplace(CSL_MatchKey(group, airline, livery), index);
 	}
 
 	return true;
@@ -873,6 +888,16 @@ void ParseFullPackage(const std::string &content, CSLPackage_t &package)
     MsgCnt.DumpResults(packageFilePath.c_str());
 }
 
+bool isPackageNameInUse(const std::string &packageName)
+{
+	for (const auto &package : gPackages)
+	{
+		if (package.name == packageName)
+			return true;
+	}
+	return false;
+}
+
 bool isPackageAlreadyLoaded(const std::string &packagePath)
 {
 	bool alreadyLoaded = false;
@@ -890,94 +915,137 @@ bool isPackageAlreadyLoaded(const std::string &packagePath)
 // This routine loads the related.txt file and also all packages.
 bool CSL_LoadCSL(const char * inFolderPath, const char * inRelatedFile, const char * inDoc8643)
 {
+	// background matching reads the index - it waits until we're done
+	std::unique_lock<std::shared_timed_mutex> lock(gCSLIndexLock);
 	bool ok = true;
 
+	// The parse depends on these and runs on workers that must not ask the sim.
+	int xplm;
+	XPLMHostApplicationID	host;
+	XPLMGetVersions(&sSimVersion, &xplm, &host);
+	char xsystem[1024];
+	XPLMGetSystemPath(xsystem);
+#if APL
+	if (XPLMIsFeatureEnabled("XPLM_USE_NATIVE_PATHS") == 0)
+		HFS2PosixPath(xsystem, xsystem, 1024);
+#endif
+	sSystemPath = xsystem;
+
+	// The catalog as we parsed it last time, and as we parse it now.
+	const string cacheFile = string(inFolderPath) + "/" + kCatalogCacheFile;
+	CSLCatalogCache cache, fresh;
+	if (gPrefs.csl_catalog_cache)
+		cache.read(cacheFile);
+	fresh.simVersion = sSimVersion;
+	fresh.systemPath = sSystemPath;
+
 	// read the list of aircraft codes
-	FILE * aircraft_fi = fopen(inDoc8643, "r");
+	fresh.doc8643 = CSL_StampFile(inDoc8643);
+	if (fresh.doc8643.size >= 0 && fresh.doc8643 == cache.doc8643)
+	{
+		fresh.codes = cache.codes;
+	}
+	else
+	{
+		FILE * aircraft_fi = fopen(inDoc8643, "r");
 
-	if (gIntPrefsFunc("debug", "model_matching", 0))
-		XPLMDebugString(string(string(inDoc8643) + " returned " + (aircraft_fi ? "valid" : "invalid") + " fp\n").c_str());
+		if (gPrefs.model_matching)
+			XPLMDebugString(string(string(inDoc8643) + " returned " + (aircraft_fi ? "valid" : "invalid") + " fp\n").c_str());
 	
-	if (aircraft_fi)
-	{
-		char	buf[1024];
-		while (fgets_multiplatform(buf, sizeof(buf), aircraft_fi))
+		if (aircraft_fi)
 		{
-			vector<string>	tokens;
-			BreakStringPvt(buf, tokens, 0, "\t\r\n");
-
-			/*
-			if (gIntPrefsFunc("debug", "model_matching", 0)) {
-				char str[20];
-				sprintf(str, "size: %i", tokens.size());
-				string s = string(str) + string(": ") + buf;
-				XPLMDebugString(s.c_str());
-			}
-			*/
-
-			// Sample line. Fields are separated by tabs
-			// ABHCO	SA-342 Gazelle 	GAZL	H1T	-
-
-			if(tokens.size() < 5) continue;
-			CSLAircraftCode_t entry;
-			entry.icao = tokens[2];
-			entry.equip = tokens[3];
-			entry.category = tokens[4][0];
-
-			// Debugging stuff
-			/*
-			if (gIntPrefsFunc("debug", "model_matching", 0)) {
-				XPLMDebugString("Loaded entry: icao code ");
-				XPLMDebugString(entry.icao.c_str());
-				XPLMDebugString(" equipment ");
-				XPLMDebugString(entry.equip.c_str());
-				XPLMDebugString(" category ");
-				switch(entry.category) {
-					case 'L': XPLMDebugString(" light"); break;
-					case 'M': XPLMDebugString(" medium"); break;
-					case 'H': XPLMDebugString(" heavy"); break;
-					default: XPLMDebugString(" other"); break;
+			char	buf[1024];
+			while (fgets_multiplatform(buf, sizeof(buf), aircraft_fi))
+			{
+				vector<string>	tokens;
+				BreakStringPvt(buf, tokens, 0, "\t\r\n");
+
+				/*
+				if (gPrefs.model_matching) {
+					char str[20];
+					sprintf(str, "size: %i", tokens.size());
+					string s = string(str) + string(": ") + buf;
+					XPLMDebugString(s.c_str());
 				}
-				XPLMDebugString("\n");
-			}
-			*/
+				*/
+
+				// Sample line. Fields are separated by tabs
+				// ABHCO	SA-342 Gazelle 	GAZL	H1T	-
+
+				if(tokens.size() < 5) continue;
+				CSLAircraftCode_t entry;
+				entry.icao = tokens[2];
+				entry.equip = tokens[3];
+				entry.category = tokens[4][0];
+
+				// Debugging stuff
+				/*
+				if (gPrefs.model_matching) {
+					XPLMDebugString("Loaded entry: icao code ");
+					XPLMDebugString(entry.icao.c_str());
+					XPLMDebugString(" equipment ");
+					XPLMDebugString(entry.equip.c_str());
+					XPLMDebugString(" category ");
+					switch(entry.category) {
+						case 'L': XPLMDebugString(" light"); break;
+						case 'M': XPLMDebugString(" medium"); break;
+						case 'H': XPLMDebugString(" heavy"); break;
+						default: XPLMDebugString(" other"); break;
+					}
+					XPLMDebugString("\n");
+				}
+				*/
 
-			gAircraftCodes[entry.icao] = entry;
+				fresh.codes.push_back(entry);
+			}
+			fclose(aircraft_fi);
+		} else {
+			XPLMDump() << XPMP_CLIENT_NAME " WARNING: could not open ICAO document 8643 at " << inDoc8643 << "\n";
+			ok = false;
 		}
-		fclose(aircraft_fi);
-	} else {
-		XPLMDump() << XPMP_CLIENT_NAME " WARNING: could not open ICAO document 8643 at " << inDoc8643 << "\n";
-		ok = false;
 	}
+	for (const CSLAircraftCode_t& entry : fresh.codes)
+		gAircraftCodes[entry.icao] = entry;
 
 	// First grab the related.txt file.
-	FILE * related_fi = fopen(inRelatedFile, "r");
-	if (related_fi)
+	fresh.related = CSL_StampFile(inRelatedFile);
+	if (fresh.related.size >= 0 && fresh.related == cache.related)
 	{
-		char	buf[1024];
-		while (fgets_multiplatform(buf, sizeof(buf), related_fi))
+		fresh.groupings = cache.groupings;
+	}
+	else
+	{
+		FILE * related_fi = fopen(inRelatedFile, "r");
+		if (related_fi)
 		{
-			if (buf[0] != ';')
+			char	buf[1024];
+			while (fgets_multiplatform(buf, sizeof(buf), related_fi))
 			{
-				vector<string>	tokens;
-				BreakStringPvt(buf, tokens, 0, " \t\r\n");
-				string	group;
-				for (size_t n = 0; n < tokens.size(); ++n)
+				if (buf[0] != ';')
 				{
-					if (n != 0) group += " ";
-					group += tokens[n];
-				}
-				for (size_t n = 0; n < tokens.size(); ++n)
-				{
-					gGroupings[tokens[n]] = group;
+					vector<string>	tokens;
+					BreakStringPvt(buf, tokens, 0, " \t\r\n");
+					string	group;
+					for (size_t n = 0; n < tokens.size(); ++n)
+					{
+						if (n != 0) group += " ";
+						group += tokens[n];
+					}
+					const CSLAtom_t groupAtom = gCSLAtoms.intern(group);
+					for (size_t n = 0; n < tokens.size(); ++n)
+					{
+						fresh.groupings.emplace_back(gCSLAtoms.intern(tokens[n]), groupAtom);
+					}
 				}
 			}
+			fclose(related_fi);
+		} else {
+			XPLMDump() << XPMP_CLIENT_NAME " WARNING: could not open related.txt at " << inRelatedFile << "\n";
+			ok = false;
 		}
-		fclose(related_fi);
-	} else {
-		XPLMDump() << XPMP_CLIENT_NAME " WARNING: could not open related.txt at " << inRelatedFile << "\n";
-		ok = false;
 	}
+	for (const auto& grouping : fresh.groupings)
+		gGroupings[grouping.first.id] = grouping.second;
 
 	// Iterate through all directories using the XPLM and load them.
 
@@ -1019,6 +1087,8 @@ bool CSL_LoadCSL(const char * inFolderPath, const char * inRelatedFile, const ch
 	free(index_buf);
 
 	vector<CSLPackage_t> packages;
+	vector<string> contents;		// each package's xsb_aircraft.txt, read just once
+	vector<const CSLCatalogCache::Package_t *> cached;	// unchanged since last time, else null
 
 	// First read all headers. This is required to resolve the DEPENDENCIES
 	for (const auto &packagePath : pckgs)
@@ -1027,30 +1097,144 @@ bool CSL_LoadCSL(const char * inFolderPath, const char * inRelatedFile, const ch
 		packageFile += "/"; //XPLMGetDirectorySeparator();
 		packageFile += "xsb_aircraft.txt";
 
-		// Continue if file does not exist or package was already loaded
-		if(!DoesFileExist(packageFile) || isPackageAlreadyLoaded(packagePath)) { continue; }
+		// Continue if package was already loaded
+		if (isPackageAlreadyLoaded(packagePath)) { continue; }
+
+		// The cached header will do unless somebody took its name since.
+		const CSLCatalogCache::Package_t * hit = cache.findValid(packagePath);
+		if (hit && !isPackageNameInUse(hit->package.name))
+		{
+			XPLMDump() << XPMP_CLIENT_NAME ": Loading package: " << packageFile << "\n";
+			CSLPackage_t package;
+			package.name = hit->package.name;
+			package.path = packagePath;
+			packages.push_back(std::move(package));
+			contents.emplace_back();
+			cached.push_back(hit);
+			continue;
+		}
+
+		// Continue if file does not exist
+		if(!DoesFileExist(packageFile)) { continue; }
 
 		XPLMDump() << XPMP_CLIENT_NAME ": Loading package: " << packageFile << "\n";
 		std::string packageContent = GetFileContent(packageFile);
 		auto package = ParsePackageHeader(packagePath, packageContent);
-		if (package.hasValidHeader()) packages.push_back(package);
+		if (package.hasValidHeader())
+		{
+			packages.push_back(std::move(package));
+			contents.push_back(std::move(packageContent));
+			cached.push_back(nullptr);
+		}
 	}
 
 	if (! packages.empty())
 	{
-		// iterator points to the first inserted package
-		auto iterator = gPackages.insert(gPackages.end(), packages.begin(), packages.end());
+		const size_t firstNew = gPackages.size();
+		gPackages.insert(gPackages.end(), packages.begin(), packages.end());
+
+		// Cached packages are only good if they were parsed against the same packages
+		// (for the paths), related.txt (for the group keys) and sim.
+		for (const auto& package : gPackages)
+			fresh.headers.emplace_back(package.name, package.path);
+		const bool cacheCurrent = fresh.headers == cache.headers && fresh.related == cache.related &&
+			fresh.simVersion == cache.simVersion && fresh.systemPath == cache.systemPath;
+
+		vector<string> logs(packages.size());
+		vector<vector<CSLFileStamp_t>> deps(packages.size());
+		vector<size_t> toParse;
+		for (size_t n = 0; n < packages.size(); ++n)
+		{
+			if (cached[n] && cacheCurrent)
+			{
+				packages[n] = cached[n]->package;
+				logs[n] = cached[n]->log;
+				deps[n] = cached[n]->deps;
+				continue;
+			}
+			if (cached[n])
+			{
+				cached[n] = nullptr;
+				contents[n] = GetFileContent(packages[n].path + "/xsb_aircraft.txt");
+			}
+			toParse.push_back(n);
+		}
 
-		// Now we do a full run
-		for (; iterator != gPackages.end(); ++iterator)
+		// Now we do a full run.  Packages only read each other's headers (DEPENDENCY and
+		// the package name in paths), so each is parsed into a private copy by a pool of
+		// workers.  The results go back in priority order, so matching doesn't change.
+		std::atomic<size_t> next(0);
+		auto worker = [&]() {
+			for (size_t t; (t = next++) < toParse.size(); )
+			{
+				const size_t n = toParse[t];
+				sParseLog = &logs[n];
+				try {
+					ParseFullPackage(contents[n], packages[n]);
+				} catch (const std::exception& e) {
+					logs[n] += XPMP_CLIENT_NAME " WARNING: failed to load package " + packages[n].path + ": " + e.what() + "\n";
+					packages[n].planes.clear();
+					for (auto& matches : packages[n].matches)
+						matches.clear();
+				}
+				sParseLog = nullptr;
+				if (gPrefs.csl_catalog_cache)
+					CSLCatalogCache::collectDeps(packages[n], packages[n].path + "/xsb_aircraft.txt", deps[n]);
+			}
+		};
+
+		const size_t threads = std::min<size_t>(toParse.size(), max(2u, std::thread::hardware_concurrency()));
+		vector<std::thread> pool;
+		for (size_t t = 1; t < threads; ++t)
+			pool.emplace_back(worker);
+		worker();
+		for (auto& t : pool)
+			t.join();
+
+		if (gPrefs.csl_catalog_cache)
 		{
-			auto &package = *iterator;
-			std::string packageFile(package.path);
-			packageFile += "/"; //XPLMGetDirectorySeparator();
-			packageFile += "xsb_aircraft.txt";
-			std::string packageContent = GetFileContent(packageFile);
-			ParseFullPackage(packageContent, package);
+			XPLMDump() << XPMP_CLIENT_NAME ": " << packages.size() - toParse.size() << " of " << packages.size() << " packages from " << cacheFile << "\n";
+			// anything parsed, a package gone or the codes or groups reread, and the file
+			// needs writing
+			if (!toParse.empty() || cache.packages.size() != packages.size() ||
+				fresh.doc8643 != cache.doc8643 || fresh.related != cache.related)
+			{
+				for (size_t n = 0; n < packages.size(); ++n)
+				{
+					fresh.packages.emplace_back();
+					fresh.packages.back().deps = std::move(deps[n]);
+					fresh.packages.back().package = packages[n];
+					fresh.packages.back().log = logs[n];
+				}
+				if (!fresh.write(cacheFile))
+					XPLMDump() << XPMP_CLIENT_NAME " WARNING: could not write " << cacheFile << "\n";
+			}
 		}
+
+		for (size_t n = 0; n < packages.size(); ++n)
+		{
+			if (!logs[n].empty())
+				XPLMDebugString(logs[n].c_str());
+			CSLPackage_t& package = gPackages[firstNew + n];
+			package = std::move(packages[n]);
+			for (CSLPlane_t& model : package.planes)
+				model.modelName = gCSLAtoms.intern(model.buildModelName());
+		}
+
+		for (size_t p = firstNew; p < gPackages.size(); ++p)
+			gMatchIndex.addPackage(gPackages[p]);
+	}
+	// we reloaded doc 8643 as well
+	gMatchIndex.rebuildFallback(gPackages, gAircraftCodes);
+	gMatchCache.invalidate();
+
+	// intern runs on the parse workers and knows no package log, so it only counts what it refused
+	static bool sAtomsFullLogged = false;
+	if (gCSLAtoms.dropped() && !sAtomsFullLogged)
+	{
+		sAtomsFullLogged = true;
+		XPLMDump() << XPMP_CLIENT_NAME " WARNING: the CSL string table is full (" << AtomTable::kMaxAtoms
+			<< " strings); " << gCSLAtoms.dropped() << " names were dropped, models using them will not match.\n";
 	}
 
 #if 0
@@ -1080,104 +1264,166 @@ static	const int kUseICAO[] =		{ 1, 1, 0, 0, 1, 1, 0, 0};
 static	const int kUseAirline[] =	{ 1, 1, 1, 1, 0, 0, 0, 0};
 static	const int kUseLivery[] =	{ 1, 0, 1, 0, 1, 0, 1, 0};
 
-CSLPlane_t *	CSL_MatchPlane(const char * inICAO, const char * inAirline, const char * inLivery, int * match_quality, bool use_default)
+CSLMatchParams_t	CSL_GetMatchParams()
 {
+	CSLMatchParams_t params;
 	XPLMPluginID	who;
-	int		total, active;
-	XPLMCountAircraft(&total, &active, &who);
-	
+	int		active;
+	XPLMCountAircraft(&params.aircraftCount, &active, &who);
+	params.log = gPrefs.model_matching;
+	params.defaultICAO = gDefaultPlane;
+	params.cacheSize = gPrefs.match_cache_size;
+	return params;
+}
+
+// Match diagnostics go to the log, or into ioLog to be logged later by the main thread.
+static void	match_log(string * ioLog, const char * inText)
+{
+	if (ioLog)
+		ioLog->append(inText);
+	else
+		XPLMDebugString(inText);
+}
+
+CSLPlane_t *	CSL_MatchPlane(const char * inICAO, const char * inAirline, const char * inLivery, int * match_quality, bool use_default)
+{
+	return CSL_MatchPlane(CSL_GetMatchParams(), inICAO, inAirline, inLivery, match_quality, use_default, nullptr);
+}
+
+static CSLPlane_t *	CSL_MatchPlaneUncached(const CSLMatchParams_t& inParams, const char * inICAO, const char * inAirline,
+									   const char * inLivery, int * match_quality, bool use_default, string * ioLog);
+
+CSLPlane_t *	CSL_MatchPlane(const CSLMatchParams_t& inParams, const char * inICAO, const char * inAirline, const char * inLivery,
+							   int * match_quality, bool use_default, string * ioLog)
+{
+	// whoever wants to see the matching at work doesn't want it from the cache
+	if (inParams.log || inParams.cacheSize <= 0)
+		return CSL_MatchPlaneUncached(inParams, inICAO, inAirline, inLivery, match_quality, use_default, ioLog);
+
+	string key(inICAO);
+	key += '\x1f';
+	if (inAirline) key += inAirline;
+	key += '\x1f';
+	if (inLivery) key += inLivery;
+	if (use_default)
+	{
+		key += '\x1f';
+		key += inParams.defaultICAO;
+	}
+
+	MatchCache::Result_t result;
+	unsigned generation;
+	if (!gMatchCache.lookup(inParams, key, result, generation))
+	{
+		result.model = CSL_MatchPlaneUncached(inParams, inICAO, inAirline, inLivery, &result.quality, use_default, ioLog);
+		gMatchCache.store(inParams, key, result, generation);
+	}
+	if (match_quality) *match_quality = result.quality;
+	return result.model;
+}
+
+CSLPlane_t *	CSL_MatchPlaneUncached(const CSLMatchParams_t& inParams, const char * inICAO, const char * inAirline, const char * inLivery,
+									   int * match_quality, bool use_default, string * ioLog)
+{
+	const int total = inParams.aircraftCount;
+
 	// First build up our various keys and info we need to do the match.
 	string	icao(inICAO);
 	string	airline(inAirline ? inAirline : "");
 	string	livery(inLivery ? inLivery : "");
-	string	group;
-	string	key;
+	string	key;			// for the log only
 
-	map<string, string>::iterator group_iter = gGroupings.find(inICAO);
-	if (group_iter != gGroupings.end())
-		group = group_iter->second;
+	// A string nobody interned is in no key, so a pass that needs it can't match.
+	CSLAtom_t	icaoAtom, airlineAtom, liveryAtom, groupAtom;
+	const bool	knownICAO = gCSLAtoms.find(icao.c_str(), icaoAtom);
+	const bool	knownAirline = gCSLAtoms.find(airline.c_str(), airlineAtom);
+	const bool	knownLivery = gCSLAtoms.find(livery.c_str(), liveryAtom);
+	if (knownICAO)
+		groupAtom = CSL_GroupOf(icaoAtom);
+	const string	group(groupAtom.c_str());
 
 	char	buf[4096];
 
-	if (gIntPrefsFunc("debug", "model_matching", 0))
+	if (inParams.log)
 	{
 		sprintf(buf, XPMP_CLIENT_NAME " MATCH - ICAO=%s AIRLINE=%s LIVERY=%s GROUP=%s\n", icao.c_str(), airline.c_str(), livery.c_str(), group.c_str());
-		XPLMDebugString(buf);
+		match_log(ioLog, buf);
 	}
 
 	// Now we go through our six passes.
 	for (int n = 0; n < match_count; ++n)
 	{
-		// Build up the right key for this pass.
-		key = kUseICAO[n] ? icao : group;
 		if (!kUseICAO[n] && group == "") {
-			if (gIntPrefsFunc("debug", "model_matching", 0)) {
+			if (inParams.log) {
 				sprintf(buf, XPMP_CLIENT_NAME " MATCH -    Skipping %d Due nil Group\n", n);
-				XPLMDebugString(buf);
+				match_log(ioLog, buf);
 			}			
+			continue;
 		}
 
         
         if (kUseAirline[n]) {
             if (airline == "") {
-                if (gIntPrefsFunc("debug", "model_matching", 0)) {
+                if (inParams.log) {
                     sprintf(buf, XPMP_CLIENT_NAME " MATCH -    Skipping %d Due Absent Airline\n", n);
-                    XPLMDebugString(buf);
+                    match_log(ioLog, buf);
                 }
                 continue;
             }
-            key += " ";
-            key += airline;
         }
         
         if (kUseLivery[n]) {
             if (livery == "") {
-                if (gIntPrefsFunc("debug", "model_matching", 0)) {
+                if (inParams.log) {
                     sprintf(buf, XPMP_CLIENT_NAME " MATCH -    Skipping %d Due Absent Livery\n", n);
-                    XPLMDebugString(buf);
+                    match_log(ioLog, buf);
                 }
                 continue;
             }
-            key += " ";
-            key += livery;
         }
 
-		if (gIntPrefsFunc("debug", "model_matching", 0))
+		if (inParams.log)
 		{
+			// the key as text is only for the log - the lookup below goes by atoms
+			key = kUseICAO[n] ? icao : group;
+			if (kUseAirline[n]) { key += " "; key += airline; }
+			if (kUseLivery[n]) { key += " "; key += livery; }
 			sprintf(buf, XPMP_CLIENT_NAME " MATCH -    Group %d key %s\n", n, key.c_str());
-			XPLMDebugString(buf);
+			match_log(ioLog, buf);
 		}
 		
-		// Now go through each group and see if we match.
-		for (size_t p = 0; p < gPackages.size(); ++p)
-		{
-			map<string,int>::iterator iter = gPackages[p].matches[n].find(key);
-			if (iter != gPackages[p].matches[n].end())
-				if (gPackages[p].planes[iter->second].plane_type != plane_Austin ||		// Special check - do NOT match a plane that isn't loaded.
-						(gPackages[p].planes[iter->second].austin_idx != -1 && gPackages[p].planes[iter->second].austin_idx < total))
-					if (gPackages[p].planes[iter->second].plane_type != plane_Obj ||
-							gPackages[p].planes[iter->second].obj_idx != -1)
-					{
-						if (NULL != match_quality) *match_quality = n;
-
-						if (gIntPrefsFunc("debug", "model_matching", 0)) {
-							sprintf(buf, XPMP_CLIENT_NAME " MATCH - Found: %s/%s/%s : %s - %s\n", 
-								gPackages[p].planes[iter->second].icao.c_str(),
-								gPackages[p].planes[iter->second].airline.c_str(),
-								gPackages[p].planes[iter->second].livery.c_str(),
-								gPackages[p].planes[iter->second].file_path.c_str(),
-								gPackages[p].planes[iter->second].texturePath.c_str());
-							XPLMDebugString(buf);
-						}
+		if ((kUseICAO[n] && !knownICAO) || (kUseAirline[n] && !knownAirline) || (kUseLivery[n] && !knownLivery))
+			continue;
 
-						return &gPackages[p].planes[iter->second];
+		// Now see who answers to this key - the index has every package's model for it, in package order.
+		const std::vector<CSLPlane_t *> * candidates = gMatchIndex.find(n, CSL_MatchKey(
+			kUseICAO[n] ? icaoAtom : groupAtom,
+			kUseAirline[n] ? airlineAtom : CSLAtom_t(),
+			kUseLivery[n] ? liveryAtom : CSLAtom_t()));
+		if (candidates)
+			for (CSLPlane_t * model : *candidates)
+				if (model->plane_type != plane_Austin ||		// Special check - do NOT match a plane that isn't loaded.
+						(model->austin_idx != -1 && model->austin_idx < total))
+				{
+					if (NULL != match_quality) *match_quality = n;
+
+					if (inParams.log) {
+						sprintf(buf, XPMP_CLIENT_NAME " MATCH - Found: %s/%s/%s : %s - %s\n", 
+							model->icao.c_str(),
+							model->airline.c_str(),
+							model->livery.c_str(),
+							model->file_path.c_str(),
+							model->texturePath.c_str());
+						match_log(ioLog, buf);
 					}
-		}
+
+					return model;
+				}
 	}
 
-	if (gIntPrefsFunc("debug", "model_matching", 0))
+	if (inParams.log)
 	{
-		XPLMDebugString(XPMP_CLIENT_NAME " MATCH - No match.\n");
+		match_log(ioLog, XPMP_CLIENT_NAME " MATCH - No match.\n");
 	}
 	if (NULL != match_quality) *match_quality = -1;
 
@@ -1190,17 +1436,17 @@ CSLPlane_t *	CSL_MatchPlane(const char * inICAO, const char * inAirline, const c
 	std::map<string, CSLAircraftCode_t>::const_iterator model_it = gAircraftCodes.find(icao);
 	if(model_it != gAircraftCodes.end()) {
 
-		if (gIntPrefsFunc("debug", "model_matching", 0))
+		if (inParams.log)
 		{
-			XPLMDebugString(XPMP_CLIENT_NAME " MATCH/acf - Looking for a ");
+			match_log(ioLog, XPMP_CLIENT_NAME " MATCH/acf - Looking for a ");
 			switch(model_it->second.category) {
-			case 'L': XPLMDebugString(" light "); break;
-			case 'M': XPLMDebugString(" medium "); break;
-			case 'H': XPLMDebugString(" heavy "); break;
-			default: XPLMDebugString(" funny "); break;
+			case 'L': match_log(ioLog, " light "); break;
+			case 'M': match_log(ioLog, " medium "); break;
+			case 'H': match_log(ioLog, " heavy "); break;
+			default: match_log(ioLog, " funny "); break;
 			}
-			XPLMDebugString(model_it->second.equip.c_str());
-			XPLMDebugString(" aircraft\n");
+			match_log(ioLog, model_it->second.equip.c_str());
+			match_log(ioLog, " aircraft\n");
 		}
 
 		// 1. match WTC, full configuration ("L2P")
@@ -1208,105 +1454,48 @@ CSLPlane_t *	CSL_MatchPlane(const char * inICAO, const char * inAirline, const c
 		// 3. match WTC, #egines ("2")
 		// 4. match WTC, enginetype ("P")
 		// 5. match WTC
-		for(int megaPass = 1; megaPass <= 10; ++megaPass) {
-            bool bMatchAirline = false;
-            int pass = -1;
-            switch(megaPass) {
-                case 1:  bMatchAirline = true;  pass = 1; break;
-                case 2:  bMatchAirline = true;  pass = 2; break;
-                case 3:  bMatchAirline = false; pass = 1; break;
-                case 4:  bMatchAirline = false; pass = 2; break;
-                case 5:  bMatchAirline = true;  pass = 3; break;
-                case 6:  bMatchAirline = true;  pass = 4; break;
-                case 7:  bMatchAirline = false; pass = 3; break;
-                case 8:  bMatchAirline = false; pass = 4; break;
-                case 9:  bMatchAirline = true;  pass = 5; break;
-                case 10: bMatchAirline = false; pass = 5; break;
-            }
-            
-            // don't need the airline pass if we don't have one
-            if (bMatchAirline && (!inAirline || !inAirline[0]))
-                continue;
-            
-			if (gIntPrefsFunc("debug", "model_matching", 0))
+		// each first with and then without airline - see XPMPMatchIndex.h
+		CSLMatchKey fallbackKey;
+		for (int pass = 1; pass <= CSLMatchIndex::kFallbackPasses; ++pass)
+		{
+			// don't need the airline pass if we don't have one (or no model has it)
+			if (CSLMatchIndex::fallbackUsesAirline(pass) && (airline.empty() || !knownAirline))
+				continue;
+			if (!CSLMatchIndex::fallbackKey(pass, model_it->second, airlineAtom, fallbackKey))
+				continue;
+
+			if (inParams.log)
 			{
-				switch(megaPass) {
-                    case 1:  XPLMDebugString(XPMP_CLIENT_NAME " Match/acf - matching airline, WTC and configuration\n");        break;
-                    case 2:  XPLMDebugString(XPMP_CLIENT_NAME " Match/acf - matching airline, WTC, #engines and enginetype\n"); break;
-                    case 3:  XPLMDebugString(XPMP_CLIENT_NAME " Match/acf - matching WTC and configuration\n");                 break;
-                    case 4:  XPLMDebugString(XPMP_CLIENT_NAME " Match/acf - matching WTC, #engines and enginetype\n");          break;
-                    case 5:  XPLMDebugString(XPMP_CLIENT_NAME " Match/acf - matching airline, WTC, #engines\n");                break;
-                    case 6:  XPLMDebugString(XPMP_CLIENT_NAME " Match/acf - matching airline, WTC, enginetype\n");              break;
-                    case 7:  XPLMDebugString(XPMP_CLIENT_NAME " Match/acf - matching WTC, #engines\n");                         break;
-                    case 8:  XPLMDebugString(XPMP_CLIENT_NAME " Match/acf - matching WTC, enginetype\n");                       break;
-                    case 9:  XPLMDebugString(XPMP_CLIENT_NAME " Match/acf - matching airline, WTC\n");                          break;
-                    case 10: XPLMDebugString(XPMP_CLIENT_NAME " Match/acf - matching WTC\n");                                   break;
-				}
+				match_log(ioLog, XPMP_CLIENT_NAME " Match/acf - matching ");
+				match_log(ioLog, CSLMatchIndex::fallbackName(pass));
+				match_log(ioLog, "\n");
 			}
 
-            for (CSLPackage_t& pckg: gPackages)
-			{
-                for (std::map<string, int>::const_iterator it = pckg.matches[bMatchAirline ? match_icao_airline : match_icao].cbegin();
-                     it != pckg.matches[bMatchAirline ? match_icao_airline : match_icao].end();
-                     ++it)
-                {
-                    CSLPlane_t& plane = pckg.planes[it->second];
-					if (plane.plane_type != plane_Austin ||		// Special check - do NOT match a plane that isn't loaded.
-						(plane.austin_idx != -1 && plane.austin_idx < total))
-						if (plane.plane_type != plane_Obj || plane.obj_idx != -1)
+			const std::vector<CSLPlane_t *> * candidates = gMatchIndex.findFallback(pass, fallbackKey);
+			if (candidates)
+				for (CSLPlane_t * model : *candidates)
+					if (model->plane_type != plane_Austin ||		// Special check - do NOT match a plane that isn't loaded.
+						(model->austin_idx != -1 && model->austin_idx < total))
+					{
+						// bingo
+						if (inParams.log)
 						{
-							// we have a candidate, lets see if it matches our criteria
-                            const std::string icao (it->first.substr(0,4));
-							std::map<string, CSLAircraftCode_t>::const_iterator m = gAircraftCodes.find(icao);
-							if(m != gAircraftCodes.cend()) {
-								// category
-								bool match = (m->second.category == model_it->second.category);
-
-								// make sure we have a valid equip type if we need it
-								if(pass < 5 && m->second.equip.length() != 3) match = false;
-
-								// engine type
-								if(match && (pass <= 2 || pass == 4))
-									match = (m->second.equip[2] == model_it->second.equip[2]);
-
-								// #engines
-								if(match && pass <= 3)
-									match = (m->second.equip[1] == model_it->second.equip[1]);
-
-								// full configuration string
-								if(match && pass == 1)
-									match = (m->second.equip == model_it->second.equip);
-                                
-                                // airline
-                                if(match && bMatchAirline && (it->first.find(' ') != std::string::npos)) {
-                                    const std::string airline (it->first.substr(it->first.find(' ')+1));
-                                    match = (airline == inAirline);
-                                }
-
-								if(match) {
-									// bingo
-									if (gIntPrefsFunc("debug", "model_matching", 0))
-									{
-										XPLMDebugString(XPMP_CLIENT_NAME " MATCH/acf - found: ");
-										XPLMDebugString(it->first.c_str());
-										XPLMDebugString("\n");
-									}
-                                    return &plane;
-								}
-							}
+							match_log(ioLog, XPMP_CLIENT_NAME " MATCH/acf - found: ");
+							match_log(ioLog, model->modelName.c_str());
+							match_log(ioLog, "\n");
 						}
-				}
-			}
+						return model;
+					}
 		}
 	}
 
-	if (gIntPrefsFunc("debug", "model_matching", 0)) {
-		XPLMDebugString(string("gAircraftCodes.find(" + icao + ") returned no match.\n").c_str());
+	if (inParams.log) {
+		match_log(ioLog, string("gAircraftCodes.find(" + icao + ") returned no match.\n").c_str());
 	}
 
-	if (!strcmp(inICAO, gDefaultPlane.c_str())) return NULL;
+	if (!strcmp(inICAO, inParams.defaultICAO.c_str())) return NULL;
 	if (!use_default) return NULL;
-	return CSL_MatchPlane(gDefaultPlane.c_str(), "", "", NULL, false);
+	return CSL_MatchPlane(inParams, inParams.defaultICAO.c_str(), "", "", NULL, false, ioLog);
 }
 
 void	CSL_Dump(void)
@@ -1317,14 +1506,14 @@ void	CSL_Dump(void)
 		XPLMDump() << XPMP_CLIENT_NAME " CSL: Package " << n << " path = " << gPackages[n].name << "\n";
 		for (size_t p = 0; p < gPackages[n].planes.size(); ++p)
 		{
-			XPLMDump() << XPMP_CLIENT_NAME " CSL:         Plane " << p << " = " << gPackages[n].planes[p].file_path << "\n";
+			XPLMDump() << XPMP_CLIENT_NAME " CSL:         Plane " << p << " = " << gPackages[n].planes[p].file_path.c_str() << "\n";
 		}
 		for (int t = 0; t < 6; ++t)
 		{
 			XPLMDump() << XPMP_CLIENT_NAME " CSL:           Table " << t << "\n";
-			for (map<string, int>::iterator i = gPackages[n].matches[t].begin(); i != gPackages[n].matches[t].end(); ++i)
+			for (map<CSLMatchKey, int>::iterator i = gPackages[n].matches[t].begin(); i != gPackages[n].matches[t].end(); ++i)
 			{
-				XPLMDump() << XPMP_CLIENT_NAME " CSL:                " << i->first << " -> " << i->second << "\n";
+				XPLMDump() << XPMP_CLIENT_NAME " CSL:                " << CSL_MatchKeyString(i->first) << " -> " << i->second << "\n";
 			}
 		}
 	}
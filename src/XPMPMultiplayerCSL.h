@@ -78,6 +78,38 @@ CSLPlane_t *	CSL_MatchPlane(
 		int *  match_quality,
 		bool use_default);
 
+/*
+ * CSLMatchParams_t
+ *
+ * Everything the matcher needs from the sim and the prefs.  Capture it on the main thread with
+ * CSL_GetMatchParams so matching itself can run on a worker (holding gCSLIndexLock shared).
+ *
+ */
+struct CSLMatchParams_t {
+	int				aircraftCount = 0;		// planes X-Plane itself has configured
+	bool			log = false;			// log the matching passes
+	std::string		defaultICAO;
+	int				cacheSize = 0;			// results to remember, see XPMPMatchCache.h
+};
+
+CSLMatchParams_t	CSL_GetMatchParams();
+
+/*
+ * CSL_MatchPlane
+ *
+ * Same as above with explicit params.  If ioLog is set, diagnostics are appended to it instead
+ * of being written to the log - required when not on the main thread.
+ *
+ */
+CSLPlane_t *	CSL_MatchPlane(
+		const CSLMatchParams_t&	inParams,
+		const char * inICAO,
+		const char * inAirline,
+		const char * inLivery,
+		int *  match_quality,
+		bool use_default,
+		std::string * ioLog);
+
 /*
  * CSL_Dump
  *
@@ -23,6 +23,8 @@
  
 #include "XPMPMultiplayerCSLOffset.h"
 #include "XPMPMultiplayerVars.h"
+#include "XPMPMatchIndex.h"
+#include "XUtils.h"
 #include "XPLMUtilities.h"
 #include <stdio.h>
 #include <algorithm>
@@ -37,6 +39,11 @@
 
 CslModelVertOffsetCalculator cslVertOffsetCalc;
 
+static std::string mtlKey(std::string inMtlCode) {
+	StringToUpper(inMtlCode);
+	return inMtlCode;
+}
+
 CslModelVertOffsetCalculator::~CslModelVertOffsetCalculator() {
 	saveUserOffsets();
 }
@@ -50,9 +57,11 @@ void CslModelVertOffsetCalculator::setResourcesDir(const string &inResDir) {
 
 void CslModelVertOffsetCalculator::findOrUpdateActualVertOffset(CSLPlane_t & inOutCslModel) {
 	// plane updating user vert offset if it's needed
+	std::string key;
 	if (!mUpdateUserOffsetForThisMtl.empty()) {
 		// check if we want to update user offset for this mtl
-		auto result = mUpdateUserOffsetForThisMtl.find(inOutCslModel.getModelName());
+		key = mtlKey(inOutCslModel.modelName.str());
+		auto result = mUpdateUserOffsetForThisMtl.find(key);
 		if (result != mUpdateUserOffsetForThisMtl.end()) {
 			inOutCslModel.isUserVertOffsetUpToDate = false;
 			mUpdateUserOffsetForThisMtl.erase(result);
@@ -64,13 +73,15 @@ void CslModelVertOffsetCalculator::findOrUpdateActualVertOffset(CSLPlane_t & inO
 		inOutCslModel.userVertOffset = 0.0;
 		inOutCslModel.isUserVertOffsetAvail = false;
 		// search for specific user offset
-		auto result2 = mAvailableUserOffsets.find(inOutCslModel.getModelName());
+		if (key.empty())
+			key = mtlKey(inOutCslModel.modelName.str());
+		auto result2 = mAvailableUserOffsets.find(key);
 		if (result2 != mAvailableUserOffsets.end()) {
 			inOutCslModel.userVertOffset = result2->second;
 			inOutCslModel.isUserVertOffsetAvail = true;
-            if (gIntPrefsFunc("debug", "model_matching", 0))
+            if (gPrefs.model_matching)
                 XPLMDebugString(std::string(XPMP_CLIENT_NAME ": The USER Y offset (" + std::to_string(inOutCslModel.userVertOffset)
-                                            + ") for the model has been found; Mtl Code: " + inOutCslModel.getModelName() + "\n").c_str());
+                                            + ") for the model has been found; Mtl Code: " + inOutCslModel.modelName.str() + "\n").c_str());
 		}
 	}
 	
@@ -78,9 +89,9 @@ void CslModelVertOffsetCalculator::findOrUpdateActualVertOffset(CSLPlane_t & inO
 	if (!inOutCslModel.isXsbVertOffsetUpToDate) {
 		inOutCslModel.isXsbVertOffsetUpToDate = true;
 		if(inOutCslModel.isXsbVertOffsetAvail) {
-            if (gIntPrefsFunc("debug", "model_matching", 0))
+            if (gPrefs.model_matching)
                 XPLMDebugString(std::string(XPMP_CLIENT_NAME ": The Y offset (" + std::to_string(inOutCslModel.xsbVertOffset)
-                                            + ") for the model has been found in the xsb file; Mtl Code: " + inOutCslModel.getModelName() + "\n").c_str());
+                                            + ") for the model has been found in the xsb file; Mtl Code: " + inOutCslModel.modelName.str() + "\n").c_str());
 		}
 	}
 	
@@ -119,9 +130,9 @@ void CslModelVertOffsetCalculator::findOrUpdateActualVertOffset(CSLPlane_t & inO
 	}
 	// if something wrong and we not have any vert offsets, use 0.0
 	if (inOutCslModel.actualVertOffsetType == eVertOffsetType::none) {
-        if (gIntPrefsFunc("debug", "model_matching", 0))
+        if (gPrefs.model_matching)
             XPLMDebugString(std::string(XPMP_CLIENT_NAME " Warning: The Y offset for the model is not found."
-                    " Will use 0 as the vert offset. Mtl code: " + inOutCslModel.getModelName() + "\n").c_str());
+                    " Will use 0 as the vert offset. Mtl code: " + inOutCslModel.modelName.str() + "\n").c_str());
 		inOutCslModel.calcVertOffset = 0.0;
 		inOutCslModel.isCalcVertOffsetAvail = true;
 		inOutCslModel.actualVertOffset = inOutCslModel.calcVertOffset;
@@ -129,34 +140,32 @@ void CslModelVertOffsetCalculator::findOrUpdateActualVertOffset(CSLPlane_t & inO
 	}
 	if (inOutCslModel.actualVertOffsetType != inOutCslModel.prevActualVertOffsetType) {
 		inOutCslModel.prevActualVertOffsetType = inOutCslModel.actualVertOffsetType;
-        if (gIntPrefsFunc("debug", "model_matching", 0))
+        if (gPrefs.model_matching)
             XPLMDebugString(std::string(XPMP_CLIENT_NAME ": Using the " + offsetTypeToString(inOutCslModel.actualVertOffsetType)
                     + " Y offset (" + std::to_string(inOutCslModel.actualVertOffset) + ") for the model. Mtl code: "
-                    + inOutCslModel.getModelName() + "\n").c_str());
+                    + inOutCslModel.modelName.str() + "\n").c_str());
 	}
 }
 
 void CslModelVertOffsetCalculator::actualVertOffsetInfo(const std::string &inMtl, std::string &outType, double &outOffset) {
-	for (auto &package : gPackages) {
-		for (auto &model : package.planes) {
-			if (model.getModelName() == inMtl) {
-				findOrUpdateActualVertOffset(model);
-				outType = offsetTypeToString(model.actualVertOffsetType);
-				outOffset = model.actualVertOffset;
-				return;
-			}
-		}
+	CSLPlane_t * model = gMatchIndex.findFirstByName(inMtl.c_str());
+	if (model) {
+		findOrUpdateActualVertOffset(*model);
+		outType = offsetTypeToString(model->actualVertOffsetType);
+		outOffset = model->actualVertOffset;
 	}
 }
 
 void CslModelVertOffsetCalculator::setUserVertOffset(const string &inMtlCode, double inOffset) {
-	mAvailableUserOffsets[inMtlCode] = inOffset;
-	mUpdateUserOffsetForThisMtl.emplace(inMtlCode);
+	std::string key = mtlKey(inMtlCode);
+	mAvailableUserOffsets[key] = inOffset;
+	mUpdateUserOffsetForThisMtl.emplace(std::move(key));
 }
 
 void CslModelVertOffsetCalculator::removeUserVertOffset(const string &inMtlCode) {
-	mAvailableUserOffsets.erase(inMtlCode);
-	mUpdateUserOffsetForThisMtl.emplace(inMtlCode);
+	std::string key = mtlKey(inMtlCode);
+	mAvailableUserOffsets.erase(key);
+	mUpdateUserOffsetForThisMtl.emplace(std::move(key));
 }
 
 /**************************************************************************************************/
@@ -220,14 +229,14 @@ bool CslModelVertOffsetCalculator::findOffsetInObj8(CSLPlane_t &inOutCslModel) {
 		}
 		inOutCslModel.isCalcVertOffsetAvail = true;
 		if (isRotateOrTranslateAnimDetected) {
-            if (gIntPrefsFunc("debug", "model_matching", 0))
+            if (gPrefs.model_matching)
                 XPLMDebugString(std::string(XPMP_CLIENT_NAME " Warning: During calculating the Y offset for the model Translate or/and Rotate animation has been found in an obj8; "
                     "So, the calculated Y offset can be wrong due to animations. "
-                    "Mtl code: " + inOutCslModel.getModelName() + "\n").c_str());
+                    "Mtl code: " + inOutCslModel.modelName.str() + "\n").c_str());
 		}
-        if (gIntPrefsFunc("debug", "model_matching", 0))
+        if (gPrefs.model_matching)
             XPLMDebugString(std::string(XPMP_CLIENT_NAME ": The Y offset (" + std::to_string(inOutCslModel.calcVertOffset) + ") for the model has been calculated from the obj8; "
-                "Mtl code: " + inOutCslModel.getModelName() + "\n").c_str());
+                "Mtl code: " + inOutCslModel.modelName.str() + "\n").c_str());
 		return true;
 	}
 	return false;
@@ -237,7 +246,7 @@ bool CslModelVertOffsetCalculator::findOffsetInObj(CSLPlane_t &inOutCslModel) {
 	if (inOutCslModel.plane_type == plane_Obj) {
 		std::ifstream file(inOutCslModel.file_path.c_str(), std::ios_base::in);
 		if (!file.is_open()) {
-			XPLMDebugString(std::string(XPMP_CLIENT_NAME " Warning: The Y offset for the model is not found in obj. Can't open the file: " + inOutCslModel.file_path + "\n").c_str());
+			XPLMDebugString(std::string(XPMP_CLIENT_NAME " Warning: The Y offset for the model is not found in obj. Can't open the file: " + inOutCslModel.file_path.str() + "\n").c_str());
 			return false;
 		}
 		double min = 0.0;
@@ -250,7 +259,7 @@ bool CslModelVertOffsetCalculator::findOffsetInObj(CSLPlane_t &inOutCslModel) {
 			if (line.size() == 0 || line.at(0) == ';' || line.at(0) == '#' || line.at(0) == '/') continue;
 			if (lineNumber == 1 && atoi(line.c_str()) >= 800) {
 				XPLMDebugString(std::string(XPMP_CLIENT_NAME " Warning: The Y offset for the model is not found in obj. "
-					"Expect obj6 or obj7 but obj8 or higher is given. The obj: " + inOutCslModel.file_path + "\n").c_str());
+					"Expect obj6 or obj7 but obj8 or higher is given. The obj: " + inOutCslModel.file_path.str() + "\n").c_str());
 				return false;
 			}
 			std::vector<std::string> tokens;
@@ -273,7 +282,7 @@ bool CslModelVertOffsetCalculator::findOffsetInObj(CSLPlane_t &inOutCslModel) {
 		}
 		if (coordLinesNumber < 3) {
 			XPLMDebugString(std::string(XPMP_CLIENT_NAME " Warning: The Y offset for the model is not found in obj. "
-				"Number of lines with coordinates is too small. The obj: " + inOutCslModel.file_path + "\n").c_str());
+				"Number of lines with coordinates is too small. The obj: " + inOutCslModel.file_path.str() + "\n").c_str());
 			return false;
 		}
 		if (min < 0.0) {
@@ -283,9 +292,9 @@ bool CslModelVertOffsetCalculator::findOffsetInObj(CSLPlane_t &inOutCslModel) {
 			inOutCslModel.calcVertOffset = -max;
 		}
 		inOutCslModel.isCalcVertOffsetAvail = true;
-        if (gIntPrefsFunc("debug", "model_matching", 0))
+        if (gPrefs.model_matching)
             XPLMDebugString(std::string(XPMP_CLIENT_NAME ": The Y offset (" + std::to_string(inOutCslModel.calcVertOffset) + ") for the model has been calculated from its obj files; "
-                "Mtl code: " + inOutCslModel.getModelName() + "\n").c_str());
+                "Mtl code: " + inOutCslModel.modelName.str() + "\n").c_str());
 		return true;
 	}
 	return false;
@@ -295,7 +304,7 @@ void CslModelVertOffsetCalculator::loadUserOffsets() {
 	std::string fileName = mResourcesDir + "userVertOffsets.txt";
 	std::ifstream file(fileName.c_str(), std::ios_base::in);
 	if (!file.is_open()) {
-        if (gIntPrefsFunc("debug", "model_matching", 0))            // conditional message, because this is an expected message on very first start
+        if (gPrefs.model_matching)            // conditional message, because this is an expected message on very first start
             XPLMDebugString(std::string(XPMP_CLIENT_NAME " Warning: Can't open the user vertical offsets file: " + fileName + "\n").c_str());
 		return;
 	}
@@ -309,16 +318,16 @@ void CslModelVertOffsetCalculator::loadUserOffsets() {
 		tokens = xmp::explode(line, ",");
 		if (tokens.size() < 2) continue;
 		if (tokens[0].size() <= 4) {// only icao
-			mAvailableUserOffsets.emplace(xmp::trim(tokens[0]), std::atof(tokens[1].c_str()));
+			mAvailableUserOffsets.emplace(mtlKey(xmp::trim(tokens[0])), std::atof(tokens[1].c_str()));
 		}
 		else if (tokens[0].size() == 7) {// icao and airline
-			mAvailableUserOffsets.emplace(xmp::trim(tokens[0].substr(0, 4)) + xmp::trim(tokens[0].substr(4)),
+			mAvailableUserOffsets.emplace(mtlKey(xmp::trim(tokens[0].substr(0, 4)) + xmp::trim(tokens[0].substr(4))),
 				std::atof(tokens[1].c_str()));
 		}
 		else if (tokens[0].size() > 7) {// icao, airline, livery
-			mAvailableUserOffsets.emplace(xmp::trim(tokens[0].substr(0, 4))
+			mAvailableUserOffsets.emplace(mtlKey(xmp::trim(tokens[0].substr(0, 4))
 				+ xmp::trim(tokens[0].substr(4, 3))
-				+ xmp::trim(tokens[0].substr(7)),
+				+ xmp::trim(tokens[0].substr(7))),
 				std::atof(tokens[1].c_str()));
 		}
 		else {
@@ -334,7 +343,10 @@ void CslModelVertOffsetCalculator::saveUserOffsets() {
 		XPLMDebugString(std::string(XPMP_CLIENT_NAME " Warning: Can't write the user vertical offsets file: " + fileName + "\n").c_str());
 		return;
 	}
-	for (auto &item : mAvailableUserOffsets) {
+	// sorted, so the file doesn't reshuffle from one save to the next
+	std::vector<std::pair<std::string, double>> items(mAvailableUserOffsets.begin(), mAvailableUserOffsets.end());
+	std::sort(items.begin(), items.end());
+	for (auto &item : items) {
 		file << item.first << ", " << item.second << std::endl;
 	}
 	file.close();
@@ -26,6 +26,8 @@
 
 #include "XPLMPlanes.h"
 #include "XPMPMultiplayerVars.h"
+#include <unordered_map>
+#include <unordered_set>
 
 class CslModelVertOffsetCalculator {
 
@@ -49,8 +51,9 @@ private:
 	void saveUserOffsets();
 	
 	std::string mResourcesDir;
-	std::map<std::string, double>mAvailableUserOffsets;
-	std::set<std::string> mUpdateUserOffsetForThisMtl;
+	// keyed by the upper case mtl code, model names are matched ignoring case
+	std::unordered_map<std::string, double> mAvailableUserOffsets;
+	std::unordered_set<std::string> mUpdateUserOffsetForThisMtl;
 };
 
 extern CslModelVertOffsetCalculator cslVertOffsetCalc;
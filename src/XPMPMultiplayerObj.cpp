@@ -80,6 +80,9 @@ static void MakePartialPathNativeObj(string& io_str)
 
 static	XPLMDataRef sFOVRef = XPLMFindDataRef("sim/graphics/view/field_of_view_deg");
 static	float		sFOV = 60.0;
+// Textures set up by the last OBJ_DrawPreparedModel, -1 = unknown
+static	int			sCurTex = -1;
+static	int			sCurLit = -1;
 
 bool 	NormalizeVec(float vec[3])
 {
@@ -256,7 +259,7 @@ int OBJ_LoadLightTexture(const string &inFilePath, bool inForceMaxTex)
 	if (sTexes.count(path) > 0)
 		return sTexes[path];
 
-	int derez = 5 - gIntPrefsFunc("planes", "resolution", 5);
+	int derez = 5 - gPrefs.resolution;
 	if (inForceMaxTex)
 		derez = 0;
 
@@ -291,7 +294,9 @@ void DeleteTexture(CSLTexture_t* texture)
 
 TextureManager::Future OBJ_LoadTexture(const string &path)
 {
-	return std::async(std::launch::async, [path]
+	// Read the pref here - the loader runs on its own thread and must not call into the client.
+	const int derez = 5 - gPrefs.resolution;
+	return std::async(std::launch::async, [path, derez]
 	{
 #if DEBUG_RESOURCE_CACHE
 		XPLMDebugString(XPMP_CLIENT_NAME ": Loading texture ");
@@ -300,7 +305,6 @@ TextureManager::Future OBJ_LoadTexture(const string &path)
 		XPLMDebugString(")\n");
 #endif
 
-		int derez = 5 - gIntPrefsFunc("planes", "resolution", 5);
 		ImageInfo im;
 		CSLTexture_t texture;
 		texture.id = 0;
@@ -585,27 +589,26 @@ void OBJ_MaintainTextures() {
 // Note that texID and litTexID are OPTIONAL! They will only be filled
 // in if the user wants to override the default texture specified by the
 // obj file
-void	OBJ_PlotModel(XPMPPlane_t *plane, float inDistance, double /*inX*/,
-					  double /*inY*/, double /*inZ*/, double /*inPitch*/, double /*inRoll*/, double /*inHeading*/)
+bool	OBJ_PrepareModel(XPMPPlane_t *plane, float inDistance, OBJ_DrawPrep_t &outPrep)
 {
 	if (! plane->objHandle)
 	{
-		plane->objHandle = gObjManager.get(plane->model->file_path, &plane->objState);
+		plane->objHandle = gObjManager.get(plane->model->file_path.str(), &plane->objState);
 		if (plane->objHandle && plane->objHandle->loadStatus == Failed)
 		{
 			// Failed to load
 			XPLMDebugString("Skipping ");
-			XPLMDebugString(plane->model->getModelName().c_str());
+			XPLMDebugString(plane->model->modelName.c_str());
 			XPLMDebugString(" since object could not be loaded.");
 			XPLMDebugString("\n");
 		}
 	}
-	if (! plane->objHandle || plane->objHandle->loadStatus == Failed) { return; }
+	if (! plane->objHandle || plane->objHandle->loadStatus == Failed) { return false; }
 
 	// Try to load a texture if not yet done. If one can't be loaded continue without texture
 	if (! plane->texHandle)
 	{
-		string texturePath = plane->model->texturePath;
+		string texturePath = plane->model->texturePath.str();
 		if (texturePath.empty()) { texturePath = plane->objHandle->defaultTexture; }
 		plane->texHandle = gTextureManager.get(texturePath, &plane->texState);
 
@@ -614,7 +617,7 @@ void	OBJ_PlotModel(XPMPPlane_t *plane, float inDistance, double /*inX*/,
 		{
 			// Failed to load
 			XPLMDebugString("Texture for ");
-			XPLMDebugString(plane->model->getModelName().c_str());
+			XPLMDebugString(plane->model->modelName.c_str());
 			XPLMDebugString(" cannot be loaded.");
 			XPLMDebugString("\n");
 		}
@@ -624,7 +627,7 @@ void	OBJ_PlotModel(XPMPPlane_t *plane, float inDistance, double /*inX*/,
 	// Try to load a texture if not yet done. If one can't be loaded continue without texture
 	if (! plane->texLitHandle)
 	{
-		string texturePath = model->textureLitPath;
+		string texturePath = model->textureLitPath.str();
 		if (texturePath.empty()) { texturePath = plane->objHandle->defaultLitTexture; }
 		plane->texLitHandle = gTextureManager.get(texturePath, &plane->texLitState);
 	}
@@ -671,11 +674,11 @@ void	OBJ_PlotModel(XPMPPlane_t *plane, float inDistance, double /*inX*/,
 	}
 	// If we didn't find a good LOD bin, we don't draw!
 	if(lodIdx == -1)
-		return;
+		return false;
 
 	// pointPool is and always was empty! returning early
 	if(obj->lods[lodIdx].pointPool.Size()==0 && obj->lods[lodIdx].dl == 0)
-		return;
+		return false;
 
 	static XPLMDataRef	night_lighting_ref = XPLMFindDataRef("sim/graphics/scenery/percent_lights_on");
 	bool	use_night = XPLMGetDataf(night_lighting_ref) > 0.25;
@@ -696,12 +699,39 @@ void	OBJ_PlotModel(XPMPPlane_t *plane, float inDistance, double /*inX*/,
 
 	if (!use_night)	lit = 0;
 	if (tex == 0) lit = 0;
-	XPLMSetGraphicsState(1, (tex != 0) + (lit != 0), 1, 1, 1, 1, 1);
-	if (tex != 0)	XPLMBindTexture2d(tex, 0);
-	if (lit != 0)	XPLMBindTexture2d(lit, 1);
-	
-	if (tex) { glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE); }
-	if (lit) { glActiveTextureARB(GL_TEXTURE1); glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_ADD); glActiveTextureARB(GL_TEXTURE0); }
+
+	outPrep.obj = obj;
+	outPrep.lod = lodIdx;
+	outPrep.tex = tex;
+	outPrep.lit = lit;
+	return true;
+}
+
+void	OBJ_BeginModelDrawing()
+{
+	sCurTex = sCurLit = -1;
+}
+
+void	OBJ_DrawPreparedModel(const OBJ_DrawPrep_t &inPrep)
+{
+	ObjInfo_t * obj = inPrep.obj;
+	const int lodIdx = inPrep.lod;
+	const int tex = inPrep.tex;
+	const int lit = inPrep.lit;
+
+	// Planes come sorted by texture, so most of the time the state is still set up
+	// from the plane before.
+	if (tex != sCurTex || lit != sCurLit)
+	{
+		XPLMSetGraphicsState(1, (tex != 0) + (lit != 0), 1, 1, 1, 1, 1);
+		if (tex != 0)	XPLMBindTexture2d(tex, 0);
+		if (lit != 0)	XPLMBindTexture2d(lit, 1);
+
+		if (tex) { glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE); }
+		if (lit) { glActiveTextureARB(GL_TEXTURE1); glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_ADD); glActiveTextureARB(GL_TEXTURE0); }
+		sCurTex = tex;
+		sCurLit = lit;
+	}
 	
 	if (obj->lods[lodIdx].dl == 0)
 	{
@@ -767,6 +797,16 @@ void	OBJ_PlotModel(XPMPPlane_t *plane, float inDistance, double /*inX*/,
 	glCallList(obj->lods[lodIdx].dl);
 }
 
+void	OBJ_PlotModel(XPMPPlane_t *plane, float inDistance, double /*inX*/,
+					  double /*inY*/, double /*inZ*/, double /*inPitch*/, double /*inRoll*/, double /*inHeading*/)
+{
+	OBJ_DrawPrep_t prep;
+	if (!OBJ_PrepareModel(plane, inDistance, prep))
+		return;
+	OBJ_BeginModelDrawing();
+	OBJ_DrawPreparedModel(prep);
+}
+
 /*****************************************************
 			Textured Lights Drawing
 
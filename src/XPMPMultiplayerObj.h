@@ -121,6 +121,23 @@ std::string OBJ_DefaultModel(const std::string &path);
 void	OBJ_PlotModel(XPMPPlane_t *plane, float inDistance, double inX, double inY,
 					  double inZ, double inPitch, double inRoll, double inHeading);
 
+// The two halves of OBJ_PlotModel, so a renderer can sort many planes by their
+// OpenGL state before drawing them.  OBJ_PrepareModel does the loading and picks
+// LOD and textures; it returns false if there is nothing to draw.  Between
+// OBJ_BeginModelDrawing and the next foreign state change, OBJ_DrawPreparedModel
+// only touches the graphics state and textures when they differ from the plane
+// drawn before.
+struct	OBJ_DrawPrep_t {
+	ObjInfo_t *		obj = nullptr;
+	int				lod = -1;
+	int				tex = 0;
+	int				lit = 0;
+};
+
+bool	OBJ_PrepareModel(XPMPPlane_t *plane, float inDistance, OBJ_DrawPrep_t &outPrep);
+void	OBJ_BeginModelDrawing();
+void	OBJ_DrawPreparedModel(const OBJ_DrawPrep_t &inPrep);
+
 // TEXTURED LIGHTS DRAWING
 void	OBJ_BeginLightDrawing();
 void	OBJ_DrawLights(XPMPPlane_t *plane, float inDistance, double inX, double inY,
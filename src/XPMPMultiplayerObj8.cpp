@@ -153,7 +153,7 @@ void	obj_init()
 	// Ben says: we need the 2.10 SDK (e.g. X-Plane 10) to have async load at all.  But we need 10.30 to pick up an SDK bug
 	// fix where async load crashes if we queue a second load before the first completes.  So for users on 10.25, they get
 	// pauses.
-	if (1 == gIntPrefsFunc("debug", "allow_obj8_async_load", 0) && sim >= 10300) {
+	if (gPrefs.allow_obj8_async_load && sim >= 10300) {
 		obj8_load_async = true;	
 	} else {
 		obj8_load_async = false;
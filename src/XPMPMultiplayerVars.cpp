@@ -27,15 +27,66 @@
 int								(* gIntPrefsFunc)(const char *, const char *, int) = NULL;
 float							(* gFloatPrefsFunc)(const char *, const char *, float) = NULL;
 
-XPMPPlaneVector					gPlanes;
+XPMPPrefs_t						gPrefs;
+
+PlaneRegistry					gPlanes;
 XPMPPlaneNotifierVector			gObservers;
+XPMPPlaneEventsNotifierVector	gEventObservers;
 XPMPRenderPlanes_f				gRenderer = NULL;
 void *							gRendererRef;
 int								gDumpOneRenderCycle = 0;
 int 							gEnableCount = 1;
 
-vector<CSLPackage_t>			gPackages;
-map<string, string>				gGroupings;
+deque<CSLPackage_t>				gPackages;
+map<uint32_t, CSLAtom_t>		gGroupings;
 
 string							gDefaultPlane;
 map<string, CSLAircraftCode_t>	gAircraftCodes;
+std::shared_timed_mutex			gCSLIndexLock;
+
+static int		pref_int(const char * inSection, const char * inKey, int inDefault)
+{
+	return gIntPrefsFunc ? gIntPrefsFunc(inSection, inKey, inDefault) : inDefault;
+}
+
+static float	pref_float(const char * inSection, const char * inKey, float inDefault)
+{
+	return gFloatPrefsFunc ? gFloatPrefsFunc(inSection, inKey, inDefault) : inDefault;
+}
+
+void XPMPLoadPrefs()
+{
+	const XPMPPrefs_t d;		// defaults
+
+	gPrefs.clamp_all_to_ground		= pref_int("planes", "clamp_all_to_ground", d.clamp_all_to_ground) != 0;
+	gPrefs.full_distance			= pref_float("planes", "full_distance", d.full_distance);
+	gPrefs.max_full_count			= pref_int("planes", "max_full_count", d.max_full_count);
+	gPrefs.resolution				= pref_int("planes", "resolution", d.resolution);
+	gPrefs.texture_anisotropy		= pref_float("planes", "texture_anisotropy", d.texture_anisotropy);
+	gPrefs.terrain_cell_size		= pref_float("planes", "terrain_cell_size", d.terrain_cell_size);
+	gPrefs.terrain_motion_threshold	= pref_float("planes", "terrain_motion_threshold", d.terrain_motion_threshold);
+	gPrefs.terrain_probes_per_frame	= pref_int("planes", "terrain_probes_per_frame", d.terrain_probes_per_frame);
+	gPrefs.prefs_refresh_interval	= pref_float("planes", "prefs_refresh_interval", d.prefs_refresh_interval);
+	gPrefs.tcas_slot_hysteresis_dist	= pref_float("planes", "tcas_slot_hysteresis_dist", d.tcas_slot_hysteresis_dist);
+	gPrefs.tcas_slot_hysteresis_frames	= pref_int("planes", "tcas_slot_hysteresis_frames", d.tcas_slot_hysteresis_frames);
+	gPrefs.label_declutter			= pref_int("planes", "label_declutter", d.label_declutter) != 0;
+	gPrefs.adaptive_lod				= pref_int("planes", "adaptive_lod", d.adaptive_lod) != 0;
+	gPrefs.lod_budget_ms			= pref_float("planes", "lod_budget_ms", d.lod_budget_ms);
+	gPrefs.lod_hysteresis			= pref_float("planes", "lod_hysteresis", d.lod_hysteresis);
+	gPrefs.lod_hold_frames			= pref_int("planes", "lod_hold_frames", d.lod_hold_frames);
+	gPrefs.lod_step					= pref_float("planes", "lod_step", d.lod_step);
+	gPrefs.lod_min_full_count		= pref_int("planes", "lod_min_full_count", d.lod_min_full_count);
+	gPrefs.lod_min_full_distance_scale	= pref_float("planes", "lod_min_full_distance_scale", d.lod_min_full_distance_scale);
+	gPrefs.lod_min_label_distance_scale	= pref_float("planes", "lod_min_label_distance_scale", d.lod_min_label_distance_scale);
+	gPrefs.lod_min_draw_distance_scale	= pref_float("planes", "lod_min_draw_distance_scale", d.lod_min_draw_distance_scale);
+	gPrefs.snapshot_delay			= pref_float("planes", "snapshot_delay", d.snapshot_delay);
+	gPrefs.snapshot_max_extrapolation	= pref_float("planes", "snapshot_max_extrapolation", d.snapshot_max_extrapolation);
+	gPrefs.queue_capacity			= pref_int("planes", "queue_capacity", d.queue_capacity);
+	gPrefs.queue_commands_per_frame	= pref_int("planes", "queue_commands_per_frame", d.queue_commands_per_frame);
+	gPrefs.queue_create_reserve		= pref_int("planes", "queue_create_reserve", d.queue_create_reserve);
+	gPrefs.match_cache_size			= pref_int("planes", "match_cache_size", d.match_cache_size);
+	gPrefs.csl_catalog_cache		= pref_int("planes", "csl_catalog_cache", d.csl_catalog_cache) != 0;
+
+	gPrefs.model_matching			= pref_int("debug", "model_matching", d.model_matching) != 0;
+	gPrefs.allow_obj8_async_load	= pref_int("debug", "allow_obj8_async_load", d.allow_obj8_async_load) == 1;
+}
@@ -31,10 +31,12 @@
  */
 
 #include <vector>
+#include <deque>
 #include <set>
 #include <string>
 #include <map>
 #include <memory>
+#include <shared_mutex>
 
 #include "XObjDefs.h"
 
@@ -43,6 +45,11 @@ using namespace std;
 #include "XPMPMultiplayer.h"
 #include "XPMPMultiplayerObj.h"
 #include "XPMPMultiplayerObj8.h"	// for obj8 attachment info
+#include "XPMPTerrainCache.h"
+#include "XPMPLabels.h"
+#include "XPMPSnapshots.h"
+#include "XPMPPlaneRegistry.h"
+#include "XPMPAtomTable.h"
 
 template <class T>
 inline
@@ -88,34 +95,37 @@ enum class eVertOffsetType {
 // and then implementation-specifc stuff.
 struct	CSLPlane_t {
 
-	string getModelName() const
+	// Only used when loading - afterwards it's in modelName.
+	string buildModelName() const
 	{
 		string modelName = "";
 		for (const auto &dir : dirNames)
 		{
-			modelName += dir;
+			modelName += dir.c_str();
 			modelName += ' ';
 		}
-		modelName += objectName;
+		modelName += objectName.c_str();
 		if (! textureName.empty())
 		{
 			modelName += ' ';
-			modelName += textureName;
+			modelName += textureName.c_str();
 		}
 		return modelName;
 	}
 
-	vector<string>              dirNames;       // Relative directories from xsb_aircrafts.txt down to object file
-	string                      objectName;     // Basename of the object file
-	string                      textureName;    // Basename of the texture file
-	string                      icao;           // Icao type of this model
-	string                      airline;        // Airline identifier. Can be empty.
-	string                      livery;         // Livery identifier. Can be empty.
+	// The strings are atoms in gCSLAtoms - most are shared by many models.
+	CSLAtom_t                   modelName;      // "dir dir object texture", set once the package is loaded
+	vector<CSLAtom_t>           dirNames;       // Relative directories from xsb_aircrafts.txt down to object file
+	CSLAtom_t                   objectName;     // Basename of the object file
+	CSLAtom_t                   textureName;    // Basename of the texture file
+	CSLAtom_t                   icao;           // Icao type of this model
+	CSLAtom_t                   airline;        // Airline identifier. Can be empty.
+	CSLAtom_t                   livery;         // Livery identifier. Can be empty.
 
 	int							plane_type;		// What kind are we?
-	string						file_path;		// Where do we load from (oz and obj, debug-use-only for OBJ8)
-	string						texturePath;	// Full path to the planes texture
-	string						textureLitPath; // Full path to the planes lit texture
+	CSLAtom_t					file_path;		// Where do we load from (oz and obj, debug-use-only for OBJ8)
+	CSLAtom_t					texturePath;	// Full path to the planes texture
+	CSLAtom_t					textureLitPath; // Full path to the planes lit texture
 	bool						moving_gear;	// Does gear retract?
 
 	// plane_Austin
@@ -156,8 +166,8 @@ struct	CSLPlane_t {
 };
 
 // These enums define the eight levels of matching we might possibly
-// make.  For each level of matching, we use a single string as a key.
-// (The string's contents vary with model - examples are shown.)
+// make.  For each level of matching, we use a single key made of up to three
+// atoms.  (The key's contents vary with model - examples are shown.)
 enum {
 	match_icao_airline_livery = 0,		//	B738 SWA SHAMU
 	match_icao_airline,					//	B738 SWA
@@ -182,13 +192,15 @@ struct	CSLPackage_t {
 	string						name;
 	string                      path;
 	vector<CSLPlane_t>			planes;
-	map<string, int>			matches[match_count];
+	map<CSLMatchKey, int>		matches[match_count];	// see CSL_MatchKey
 
 };
 
-extern vector<CSLPackage_t>		gPackages;
+// A deque so packages loaded later never move the planes we've already handed out.
+extern deque<CSLPackage_t>		gPackages;
 
-extern map<string, string>		gGroupings;
+// ICAO atom -> atom of its related.txt line
+extern map<uint32_t, CSLAtom_t>	gGroupings;
 
 /**************** Model matching using ICAO doc 8643
 		(http://www.icao.int/anb/ais/TxtFiles/Doc8643.txt) ***********/
@@ -201,22 +213,34 @@ struct CSLAircraftCode_t {
 
 extern map<string, CSLAircraftCode_t>	gAircraftCodes;
 
+// Guards gPackages, gGroupings, gAircraftCodes and gMatchIndex against the background model matcher.
+// The main thread takes it exclusive when changing them; the matcher reads under a shared lock.
+extern std::shared_timed_mutex			gCSLIndexLock;
+
 /**************** PLANE OBJECTS ********************/
 
 // This plane struct reprents one instance of a 
 // multiplayer plane.
 struct	XPMPPlane_t {
 
+	XPMPPlaneID				id = nullptr;		// our handle, see XPMPPlaneRegistry.h
+
 	// Modeling properties
 	string					icao;
 	string					airline;
 	string					livery;
 	CSLPlane_t *			model = nullptr; // May be null if no good match
 	int 					match_quality;
+	unsigned				matchRequest = 0;	// bumped on every model change, a background match must still agree
 	
 	// This callback is used to pull data from the client for posiitons, etc.
 	XPMPPlaneData_f			dataFunc;
 	void *					ref = nullptr;
+	// Push-driven planes get their data through XPMPUpdatePlanes instead - pushed
+	// holds the xpmpDataType_ bits of what we got at least once.
+	bool					pushDriven = false;
+	int						pushed = 0;
+	PlaneSnapshotBuffer		snapshots;			// timestamped positions, see XPMPPushPlaneSnapshots
 	
 	// This is last known data we got for the plane, with timestamps.
 	int						posAge;
@@ -235,11 +259,14 @@ struct	XPMPPlane_t {
 	TextureManager::TransientState  texState;
 	TextureManager::TransientState  texLitState;
     
-    int                     multiIdx = -1;       // which sim/multiplayer/plane-index used last?
+    int                     slotGraceFrames = 0; // frames we kept our TCAS slot though behind the cut-off
+    int                     tcasCycle = -1;      // last render plan that put us on TCAS
+
+	TerrainProbeMemo		terrainMemo;		// last terrain height found for ground clamping
+	LabelLayout_t			labelLayout;		// measured label, redone when label text/colour change
 };
 
 typedef	XPMPPlane_t *								XPMPPlanePtr;
-typedef	vector<std::unique_ptr<XPMPPlane_t>>		XPMPPlaneVector;
 
 // Notifiers - clients can install callbacks and be told when a plane's
 // data changes.
@@ -247,14 +274,68 @@ typedef	pair<XPMPPlaneNotifier_f, void *>			XPMPPlaneNotifierPair;
 typedef	pair<XPMPPlaneNotifierPair, XPLMPluginID>	XPMPPlaneNotifierTripple;
 typedef	vector<XPMPPlaneNotifierTripple>			XPMPPlaneNotifierVector;
 
+// Same for the batch notifiers.
+typedef	pair<XPMPPlaneEventsNotifier_f, void *>		XPMPPlaneEventsNotifierPair;
+typedef	pair<XPMPPlaneEventsNotifierPair, XPLMPluginID>	XPMPPlaneEventsNotifierTripple;
+typedef	vector<XPMPPlaneEventsNotifierTripple>		XPMPPlaneEventsNotifierVector;
+
 // Prefs funcs - the client provides callbacks to pull ini key values 
 // for various functioning.
 
 extern int			(* gIntPrefsFunc)(const char *, const char *, int);
 extern float		(* gFloatPrefsFunc)(const char *, const char *, float);
 
-extern XPMPPlaneVector					gPlanes;				// All planes
+// Preferences - the prefs funcs end up in the client's ini lookup, which is far too
+// slow for anything that runs per plane or per frame.  Everything we use is pulled
+// once into gPrefs and refreshed by XPMPReloadPrefs() or every
+// prefs_refresh_interval seconds.  The fields are named after their ini keys.
+struct XPMPPrefs_t {
+	// [planes]
+	bool		clamp_all_to_ground = false;
+	float		full_distance = 3.0f;				// statute miles
+	int			max_full_count = 100;
+	int			resolution = 5;
+	float		texture_anisotropy = 0.0f;
+	float		terrain_cell_size = 4.0f;			// meters
+	float		terrain_motion_threshold = 0.5f;	// meters
+	int			terrain_probes_per_frame = 64;
+	float		prefs_refresh_interval = 10.0f;		// seconds, 0 = only on XPMPReloadPrefs()
+	float		tcas_slot_hysteresis_dist = 1000.0f;	// meters behind the TCAS cut-off a plane keeps its slot
+	int			tcas_slot_hysteresis_frames = 120;	// ...for at most this many frames
+	bool		label_declutter = true;				// hide labels that would overlap nearer ones
+	// adaptive level of detail - see XPMPLodBudget.h
+	bool		adaptive_lod = false;
+	float		lod_budget_ms = 2.0f;				// what the renderer may cost per frame, not counting the data pull
+	float		lod_hysteresis = 0.15f;				// +- fraction of the budget we don't react to
+	int			lod_hold_frames = 30;				// frames outside the band before a step
+	float		lod_step = 0.1f;					// detail level change per step (level is 0..1)
+	int			lod_min_full_count = 10;			// limits at level 0...
+	float		lod_min_full_distance_scale = 0.25f;	// ...as fractions of the normal distances
+	float		lod_min_label_distance_scale = 0.3f;
+	float		lod_min_draw_distance_scale = 0.5f;
+	float		snapshot_delay = 0.5f;				// seconds we render snapshot planes in the past
+	float		snapshot_max_extrapolation = 2.0f;	// seconds we dead-reckon past the newest snapshot
+	int			queue_capacity = 4096;				// commands XPMPQueue* can hold - read at init only
+	int			queue_commands_per_frame = 1000;	// applied per frame at most, 0 = all
+	int			queue_create_reserve = 256;			// XPMPQueueCreatePlane calls per frame - read at init only
+	int			match_cache_size = 4096;			// model match results remembered, 0 = off
+	bool		csl_catalog_cache = true;			// keep parsed CSL packages in a cache file, see XPMPCatalogCache.h
+	// [debug]
+	bool		model_matching = false;
+	bool		allow_obj8_async_load = false;
+};
+
+extern XPMPPrefs_t						gPrefs;
+
+// Pulls all of gPrefs from the prefs funcs.
+void XPMPLoadPrefs();
+
+// XPMPGetPlaneData for a plane we already looked up.
+XPMPPlaneCallbackResult	XPMPFetchPlaneData(XPMPPlane_t * inPlane, XPMPPlaneDataType inDataType, void * outData);
+
+extern PlaneRegistry					gPlanes;				// All planes
 extern XPMPPlaneNotifierVector			gObservers;				// All notifiers
+extern XPMPPlaneEventsNotifierVector	gEventObservers;		// All batch notifiers
 extern XPMPRenderPlanes_f				gRenderer;				// The actual rendering func
 extern void *							gRendererRef;			// The actual rendering func
 extern int								gDumpOneRenderCycle;	// Debug
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "XPMPPlaneEvents.h"
+
+PlaneEventQueue		gPlaneEvents;
+
+void PlaneEventQueue::post(XPMPPlaneID inPlane, XPMPPlaneNotification inNotification)
+{
+	auto i = mPending.find(inPlane);
+	if (i == mPending.end())
+	{
+		mPending.emplace(inPlane, mEvents.size());
+		mEvents.push_back({ inPlane, inNotification });
+		return;
+	}
+
+	XPMPPlaneEvent_t & pending = mEvents[i->second];
+	if (pending.notification == xpmp_PlaneNotification_Created)
+	{
+		// Nobody heard of the plane yet - a new model is still news of its creation,
+		// and if it's gone again there's nothing to tell.
+		if (inNotification == xpmp_PlaneNotification_Destroyed)
+		{
+			pending.notification = 0;
+			mPending.erase(i);
+		}
+	}
+	else
+		pending.notification = inNotification;
+}
+
+void PlaneEventQueue::take(std::vector<XPMPPlaneEvent_t>& outEvents)
+{
+	for (const XPMPPlaneEvent_t & e : mEvents)
+		if (e.notification != 0)
+			outEvents.push_back(e);
+	clear();
+}
+
+void PlaneEventQueue::clear()
+{
+	mEvents.clear();
+	mPending.clear();
+}
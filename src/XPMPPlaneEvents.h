@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef XPMPPLANEEVENTS_H
+#define XPMPPLANEEVENTS_H
+
+/*
+ * XPMPPlaneEvents
+ *
+ * Plane notifications are not sent from inside the API calls that cause them.  They are
+ * posted here and delivered to all notifiers once a frame (see XPMPRenderMultiplayerPlanes).
+ * Events for the same plane are coalesced on the way: a plane created and destroyed in
+ * the same frame never shows up, a created plane whose model changed is just created,
+ * and so on - each plane has at most one pending event.
+ *
+ */
+
+#include "XPMPMultiplayer.h"
+
+#include <unordered_map>
+#include <vector>
+
+class PlaneEventQueue {
+
+public:
+	void post(XPMPPlaneID inPlane, XPMPPlaneNotification inNotification);
+
+	// Moves the pending events, oldest first, into outEvents.
+	void take(std::vector<XPMPPlaneEvent_t>& outEvents);
+
+	bool empty() const { return mPending.empty(); }
+	void clear();
+
+private:
+	std::vector<XPMPPlaneEvent_t>					mEvents;	// cancelled ones have notification 0
+	std::unordered_map<XPMPPlaneID, size_t>			mPending;	// plane -> its event in mEvents
+};
+
+extern PlaneEventQueue		gPlaneEvents;
+
+#endif /* XPMPPLANEEVENTS_H */
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "XPMPPlaneHotStore.h"
+
+template <class T>
+static void hot_swap_remove(std::vector<T> & ioArray, size_t inRow)
+{
+	ioArray[inRow] = ioArray.back();
+	ioArray.pop_back();
+}
+
+void PlaneHotStore::push_back(XPMPPlane_t * inPlane)
+{
+	plane.push_back(inPlane);
+	lat.push_back(0.0);
+	lon.push_back(0.0);
+	elevation.push_back(0.0);
+	pitch.push_back(0.0f);
+	roll.push_back(0.0f);
+	heading.push_back(0.0f);
+	x.push_back(0.0f);
+	y.push_back(0.0f);
+	z.push_back(0.0f);
+	lights.push_back(xpmp_LightStatus());
+	state.push_back(XPLMPlaneDrawState_t());
+	model.push_back(nullptr);
+	multiIdx.push_back(-1);
+	flags.push_back(0);
+}
+
+void PlaneHotStore::swap_remove(size_t inRow)
+{
+	hot_swap_remove(plane, inRow);
+	hot_swap_remove(lat, inRow);
+	hot_swap_remove(lon, inRow);
+	hot_swap_remove(elevation, inRow);
+	hot_swap_remove(pitch, inRow);
+	hot_swap_remove(roll, inRow);
+	hot_swap_remove(heading, inRow);
+	hot_swap_remove(x, inRow);
+	hot_swap_remove(y, inRow);
+	hot_swap_remove(z, inRow);
+	hot_swap_remove(lights, inRow);
+	hot_swap_remove(state, inRow);
+	hot_swap_remove(model, inRow);
+	hot_swap_remove(multiIdx, inRow);
+	hot_swap_remove(flags, inRow);
+}
+
+void PlaneHotStore::clear()
+{
+	plane.clear();
+	lat.clear();
+	lon.clear();
+	elevation.clear();
+	pitch.clear();
+	roll.clear();
+	heading.clear();
+	x.clear();
+	y.clear();
+	z.clear();
+	lights.clear();
+	state.clear();
+	model.clear();
+	multiIdx.clear();
+	flags.clear();
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef XPMPPLANEHOTSTORE_H
+#define XPMPPLANEHOTSTORE_H
+
+/*
+ * XPMPPlaneHotStore
+ *
+ * What the renderer touches for every plane every frame, as a structure of arrays:
+ * one row per plane, in the registry's dense order (see XPMPPlaneRegistry.h, which
+ * keeps the rows in step as planes come and go).  The data pull copies a plane's
+ * position, model and lights in once per cycle; from then on culling, TCAS and the
+ * drawing passes run over these arrays and leave XPMPPlane_t - strings, resource
+ * handles, callbacks - alone.
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "XPLMPlanes.h"
+#include "XPMPMultiplayer.h"
+
+struct XPMPPlane_t;
+struct CSLPlane_t;
+
+enum {
+	hot_Position		= 1,		// we got a position this cycle
+	hot_ClampToGround	= 2,
+	hot_Surfaces		= 4,		// the client had surfaces for us this cycle
+	hot_Radar			= 8			// ...and radar
+};
+
+struct PlaneHotStore {
+	std::vector<XPMPPlane_t *>			plane;		// the cold rest of the plane
+	std::vector<double>					lat;
+	std::vector<double>					lon;
+	std::vector<double>					elevation;	// feet
+	std::vector<float>					pitch;
+	std::vector<float>					roll;
+	std::vector<float>					heading;
+	std::vector<float>					x;			// local OpenGL, incl. vertical offset and clamping
+	std::vector<float>					y;
+	std::vector<float>					z;
+	std::vector<xpmp_LightStatus>		lights;
+	std::vector<XPLMPlaneDrawState_t>	state;		// flaps, gear, etc.
+	std::vector<CSLPlane_t *>			model;
+	std::vector<int>					multiIdx;	// TCAS slot, -1 = none
+	std::vector<uint8_t>				flags;		// hot_ bits
+
+	size_t	size() const					{ return plane.size(); }
+
+	void	push_back(XPMPPlane_t * inPlane);
+	// moves the last row into inRow
+	void	swap_remove(size_t inRow);
+	void	clear();
+};
+
+#endif /* XPMPPLANEHOTSTORE_H */
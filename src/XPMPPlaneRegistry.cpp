@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "XPMPPlaneRegistry.h"
+#include "XPMPMultiplayerVars.h"
+
+// Slot bits, the rest of the handle is the generation.  Slot + 1 is stored so no
+// handle is ever NULL.
+static const int		kSlotBits = sizeof(uintptr_t) >= 8 ? 32 : 20;
+static const uintptr_t	kSlotMask = (uintptr_t(1) << kSlotBits) - 1;
+static const uintptr_t	kGenerationMask = sizeof(uintptr_t) >= 8 ? 0xFFFFFFFF : ((uintptr_t(1) << (32 - kSlotBits)) - 1);
+
+XPMPPlaneID PlaneRegistry::encode(uint32_t inSlot, uint32_t inGeneration)
+{
+	const uintptr_t v = ((uintptr_t(inGeneration) & kGenerationMask) << kSlotBits) | (uintptr_t(inSlot) + 1);
+	return reinterpret_cast<XPMPPlaneID>(v);
+}
+
+bool PlaneRegistry::decode(XPMPPlaneID inID, uint32_t & outSlot, uint32_t & outGeneration)
+{
+	const uintptr_t v = reinterpret_cast<uintptr_t>(inID);
+	if ((v & kSlotMask) == 0)
+		return false;
+	outSlot = static_cast<uint32_t>((v & kSlotMask) - 1);
+	outGeneration = static_cast<uint32_t>((v >> kSlotBits) & kGenerationMask);
+	return true;
+}
+
+uint32_t PlaneRegistry::takeSlot()
+{
+	uint32_t slot;
+	if (mFreeHead != kNone)
+	{
+		slot = mFreeHead;
+		mFreeHead = mSlots[slot].nextFree;
+	} else {
+		slot = static_cast<uint32_t>(mSlots.size());
+		mSlots.emplace_back();
+	}
+	Slot & s = mSlots[slot];
+	s.used = true;
+	s.nextFree = kNone;
+	return slot;
+}
+
+XPMPPlaneID PlaneRegistry::reserve()
+{
+	const uint32_t slot = takeSlot();
+	return encode(slot, mSlots[slot].generation);
+}
+
+XPMPPlane_t * PlaneRegistry::insert(std::unique_ptr<XPMPPlane_t> inPlane, XPMPPlaneID inReserved)
+{
+	uint32_t slot, generation;
+	if (inReserved)
+	{
+		if (!decode(inReserved, slot, generation) || slot >= mSlots.size())
+			return nullptr;
+		const Slot & s = mSlots[slot];
+		if (!s.used || s.plane || s.generation != generation)
+			return nullptr;
+	} else
+		slot = takeSlot();
+
+	Slot & s = mSlots[slot];
+	inPlane->id = encode(slot, s.generation);
+	s.plane = std::move(inPlane);
+	s.dense = static_cast<uint32_t>(mHot.size());
+	mHot.push_back(s.plane.get());
+	mHot.model.back() = s.plane->model;
+	return s.plane.get();
+}
+
+bool PlaneRegistry::erase(XPMPPlaneID inID)
+{
+	uint32_t slot, generation;
+	if (!decode(inID, slot, generation) || slot >= mSlots.size())
+		return false;
+	Slot & s = mSlots[slot];
+	if (!s.used || s.generation != generation)
+		return false;
+
+	if (s.plane)
+	{
+		// fill the hole with the last plane
+		XPMPPlane_t * last = mHot.plane.back();
+		uint32_t lastSlot, lastGeneration;
+		decode(last->id, lastSlot, lastGeneration);
+		mSlots[lastSlot].dense = s.dense;
+		mHot.swap_remove(s.dense);
+		s.plane.reset();
+	}
+	s.dense = kNone;
+	s.used = false;
+	s.generation = static_cast<uint32_t>((s.generation + 1) & kGenerationMask);
+	s.nextFree = mFreeHead;
+	mFreeHead = slot;
+	return true;
+}
+
+size_t PlaneRegistry::indexOf(const XPMPPlane_t * inPlane) const
+{
+	uint32_t slot, generation;
+	decode(inPlane->id, slot, generation);
+	return mSlots[slot].dense;
+}
+
+void PlaneRegistry::clear()
+{
+	mHot.clear();
+	mSlots.clear();
+	mFreeHead = kNone;
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef XPMPPLANEREGISTRY_H
+#define XPMPPLANEREGISTRY_H
+
+/*
+ * XPMPPlaneRegistry
+ *
+ * All planes, as a generational slot map.  An XPMPPlaneID is not a pointer but a
+ * handle: slot index plus the generation the slot had when the plane was created.
+ * Destroying a plane bumps its slot's generation, so an old handle no longer finds
+ * anything even once the slot is reused.  Create, destroy and lookup are O(1); the
+ * planes are also kept in a dense array for XPMPGetNthPlane, where destroying a plane
+ * moves the last one into its place.  That dense array is the render hot store, so
+ * a plane's index there is also its row in the hot store.
+ *
+ */
+
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include "XPMPMultiplayer.h"
+#include "XPMPPlaneHotStore.h"
+
+struct XPMPPlane_t;
+
+class PlaneRegistry {
+
+public:
+	// Takes a slot for a plane that is inserted later - the handle is valid from now
+	// on, but finds nothing until then.
+	XPMPPlaneID		reserve();
+
+	// Takes ownership and sets inPlane->id.  inReserved is a handle from reserve(), or
+	// NULL for a fresh one.  Returns NULL if inReserved is no longer reserved.
+	XPMPPlane_t *	insert(std::unique_ptr<XPMPPlane_t> inPlane, XPMPPlaneID inReserved = nullptr);
+
+	// Destroys the plane (or drops the reservation).  False for a stale handle.
+	bool			erase(XPMPPlaneID inID);
+
+	// NULL for stale or merely reserved handles.
+	XPMPPlane_t *	find(XPMPPlaneID inID) const
+	{
+		uint32_t slot, generation;
+		if (!decode(inID, slot, generation) || slot >= mSlots.size())
+			return nullptr;
+		const Slot & s = mSlots[slot];
+		return (s.used && s.generation == generation) ? s.plane.get() : nullptr;
+	}
+
+	size_t			size() const				{ return mHot.size(); }
+	XPMPPlane_t *	at(size_t inIndex) const	{ return mHot.plane[inIndex]; }
+
+	// The plane's row in hot() - only valid for planes that are in here.
+	size_t			indexOf(const XPMPPlane_t * inPlane) const;
+
+	PlaneHotStore &	hot()						{ return mHot; }
+
+	void			clear();
+
+private:
+	static const uint32_t	kNone = 0xFFFFFFFF;
+
+	struct Slot {
+		std::unique_ptr<XPMPPlane_t>	plane;
+		uint32_t						generation = 1;
+		uint32_t						dense = kNone;		// row in mHot
+		uint32_t						nextFree = kNone;
+		bool							used = false;
+	};
+
+	static XPMPPlaneID	encode(uint32_t inSlot, uint32_t inGeneration);
+	static bool			decode(XPMPPlaneID inID, uint32_t & outSlot, uint32_t & outGeneration);
+
+	uint32_t			takeSlot();
+
+	std::vector<Slot>			mSlots;
+	PlaneHotStore				mHot;
+	uint32_t					mFreeHead = kNone;
+};
+
+#endif /* XPMPPLANEREGISTRY_H */
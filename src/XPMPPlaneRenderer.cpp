@@ -28,6 +28,13 @@
 #include "XPMPMultiplayerVars.h"
 #include "XPMPMultiplayerObj.h"
 #include "XPMPMultiplayerObj8.h"
+#include "XPMPCull.h"
+#include "XPMPTerrainCache.h"
+#include "XPMPTcasSlots.h"
+#include "XPMPLabels.h"
+#include "XPMPDrawQueue.h"
+#include "XPMPRenderStats.h"
+#include "XPMPLodBudget.h"
 
 #include "XPLMGraphics.h"
 #include "XPLMDisplay.h"
@@ -35,8 +42,10 @@
 #include "XPLMPlanes.h"
 #include "XPLMUtilities.h"
 #include "XPLMDataAccess.h"
+#include "XPLMProcessing.h"
 
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 #include <algorithm>
 
@@ -55,8 +64,6 @@
 
 // Turn this on to get a lot of diagnostic info on who's visible, etc.
 #define 	DEBUG_RENDERER 0
-// Turn this on to put rendering stats in datarefs for realtime observatoin.
-#define		RENDERER_STATS 0
 
 // Maximum altitude difference in feet for TCAS blips
 #define		MAX_TCAS_ALTDIFF		10000
@@ -67,6 +74,9 @@
 
 extern bool	gHasControlOfAIAircraft;
 const float FAR_AWAY_VAL_GL = 9999999.9f;    // don't dare using NAN...but with this coordinate for x/y/z a plane should be far out and virtually invisible
+// Index of the values in multiDataRefsTy::written and in gTcasArrayRef
+enum { MDR_X = 0, MDR_Y, MDR_Z, MDR_PITCH, MDR_ROLL, MDR_HEADING, MDR_COUNT };
+
 struct multiDataRefsTy {
     XPLMDataRef X;
     XPLMDataRef Y;
@@ -75,7 +85,10 @@ struct multiDataRefsTy {
     XPLMDataRef roll;       // phi
     XPLMDataRef heading;    // psi
     
-    bool        bSlotTaken = false; // during drawing: is this multiplayer plane idx used or not?
+    // shadow copy of what we last wrote to the sim, so unchanged values aren't written again
+    float       written[MDR_COUNT];
+    bool        bValid = false;     // false: shadow unknown, next write goes through in full
+    bool        bParked = false;    // slot is parked at FAR_AWAY_VAL_GL
     
     // all OK?
     inline operator bool () const { return X && Y && Z && pitch && roll && heading; }
@@ -83,18 +96,23 @@ struct multiDataRefsTy {
 
 std::vector<multiDataRefsTy>        gMultiRef;
 
-bool gDrawLabels = true;
+// Newer sims expose the TCAS targets as float arrays (element 0 is the user's plane,
+// so slot n is element n+1).  If we can write them we collect the changes of a frame
+// and send each array in one XPLMSetDatavf instead of up to six XPLMSetDataf per slot.
+static const char * kTcasArrayNames[MDR_COUNT] = {
+	"sim/cockpit2/tcas/targets/position/x",
+	"sim/cockpit2/tcas/targets/position/y",
+	"sim/cockpit2/tcas/targets/position/z",
+	"sim/cockpit2/tcas/targets/position/the",
+	"sim/cockpit2/tcas/targets/position/phi",
+	"sim/cockpit2/tcas/targets/position/psi" };
+static XPLMDataRef					gTcasArrayRef[MDR_COUNT];
+static bool							gUseTcasArrays = false;
+static std::vector<float>			gTcasArrayBuf;				// scratch for one array write
+static int							gTcasDirtyLo = -1;			// dirty slot range [lo, hi]
+static int							gTcasDirtyHi = -1;
 
-struct cull_info_t {					// This struct has everything we need to cull fast!
-	float	model_view[16];				// The model view matrix, to get from local OpenGL to eye coordinates.
-	float	proj[16];					// Proj matrix - this is just a hack to use for gluProject.
-	float	nea_clip[4];				// Four clip planes in the form of Ax + By + Cz + D = 0 (ABCD are in the array.)
-	float	far_clip[4];				// They are oriented so the positive side of the clip plane is INSIDE the view volume.
-	float	lft_clip[4];
-	float	rgt_clip[4];
-	float	bot_clip[4];
-	float	top_clip[4];
-};
+bool gDrawLabels = true;
 
 static bool				gCullInfoInitialised = false;
 static XPLMDataRef		projectionMatrixRef = nullptr;
@@ -162,86 +180,23 @@ static void setup_cull_info(cull_info_t * i)
 	i->far_clip[0] =-i->proj[2]+i->proj[3];	i->far_clip[1] =-i->proj[6]+i->proj[7];	i->far_clip[2] =-i->proj[10]+i->proj[11];	i->far_clip[3] =-i->proj[14]+i->proj[15];
 }
 
-static int sphere_is_visible(const cull_info_t * i, float x, float y, float z, float r)
-{
-	// First: we transform our coordinate into eye coordinates from model-view.
-	float xp = x * i->model_view[0] + y * i->model_view[4] + z * i->model_view[ 8] + i->model_view[12];
-	float yp = x * i->model_view[1] + y * i->model_view[5] + z * i->model_view[ 9] + i->model_view[13];
-	float zp = x * i->model_view[2] + y * i->model_view[6] + z * i->model_view[10] + i->model_view[14];
-
-	// Now - we apply the "plane equation" of each clip plane to see how far from the clip plane our point is.
-	// The clip planes are directed: positive number distances mean we are INSIDE our viewing area by some distance;
-	// negative means outside.  So ... if we are outside by less than -r, the ENTIRE sphere is out of bounds.
-	// We are not visible!  We do the near clip plane, then sides, then far, in an attempt to try the planes
-	// that will eliminate the most geometry first...half the world is behind the near clip plane, but not much is
-	// behind the far clip plane on sunny day.
-	if ((xp * i->nea_clip[0] + yp * i->nea_clip[1] + zp * i->nea_clip[2] + i->nea_clip[3] + r) < 0)	return false;
-	if ((xp * i->bot_clip[0] + yp * i->bot_clip[1] + zp * i->bot_clip[2] + i->bot_clip[3] + r) < 0)	return false;
-	if ((xp * i->top_clip[0] + yp * i->top_clip[1] + zp * i->top_clip[2] + i->top_clip[3] + r) < 0)	return false;
-	if ((xp * i->lft_clip[0] + yp * i->lft_clip[1] + zp * i->lft_clip[2] + i->lft_clip[3] + r) < 0)	return false;
-	if ((xp * i->rgt_clip[0] + yp * i->rgt_clip[1] + zp * i->rgt_clip[2] + i->rgt_clip[3] + r) < 0)	return false;
-	if ((xp * i->far_clip[0] + yp * i->far_clip[1] + zp * i->far_clip[2] + i->far_clip[3] + r) < 0)	return false;
-	return true;
-}
-
-static float sphere_distance_sqr(const cull_info_t * i, float x, float y, float z)
-{
-	float xp = x * i->model_view[0] + y * i->model_view[4] + z * i->model_view[ 8] + i->model_view[12];
-	float yp = x * i->model_view[1] + y * i->model_view[5] + z * i->model_view[ 9] + i->model_view[13];
-	float zp = x * i->model_view[2] + y * i->model_view[6] + z * i->model_view[10] + i->model_view[14];
-	return xp*xp+yp*yp+zp*zp;
-}
-
-static void convert_to_2d(const cull_info_t * i, const int * vp, float x, float y, float z, float w, float * out_x, float * out_y)
-{
-	float xe = x * i->model_view[0] + y * i->model_view[4] + z * i->model_view[ 8] + w * i->model_view[12];
-	float ye = x * i->model_view[1] + y * i->model_view[5] + z * i->model_view[ 9] + w * i->model_view[13];
-	float ze = x * i->model_view[2] + y * i->model_view[6] + z * i->model_view[10] + w * i->model_view[14];
-	float we = x * i->model_view[3] + y * i->model_view[7] + z * i->model_view[11] + w * i->model_view[15];
-
-	float xc = xe * i->proj[0] + ye * i->proj[4] + ze * i->proj[ 8] + we * i->proj[12];
-	float yc = xe * i->proj[1] + ye * i->proj[5] + ze * i->proj[ 9] + we * i->proj[13];
-	//	float zc = xe * i->proj[2] + ye * i->proj[6] + ze * i->proj[10] + we * i->proj[14];
-	float wc = xe * i->proj[3] + ye * i->proj[7] + ze * i->proj[11] + we * i->proj[15];
-	
-	xc /= wc;
-	yc /= wc;
-	//	zc /= wc;
-
-	*out_x = static_cast<float>(vp[0]) + (1.0f + xc) * static_cast<float>(vp[2]) / 2.0f;
-	*out_y = static_cast<float>(vp[1]) + (1.0f + yc) * static_cast<float>(vp[3]) / 2.0f;
-}
-
-
-#if RENDERER_STATS
-
-static int		GetRendererStat(void * inRefcon)
-{
-	return *((int *) inRefcon);
-}
-
-#endif
-
-static	int		gTotPlanes = 0;			// Counters
-static	int		gACFPlanes = 0;			// Number of Austin's planes we drew in full
-static	int		gNavPlanes = 0;			// Number of Austin's planes we drew with lights only
-static	int		gOBJPlanes = 0;			// Number of our OBJ planes we drew in full
-
 static	XPLMDataRef		gVisDataRef = NULL;		// Current air visiblity for culling.
 static	XPLMDataRef		gAltitudeRef = NULL;	// Current aircraft altitude (for TCAS)
 
-static XPLMProbeRef terrainProbe = NULL; // Probe to probe where the ground is for clamping
-
 
 void			XPMPInitDefaultPlaneRenderer(void)
 {
-	terrainProbe = XPLMCreateProbe(xplm_ProbeY);
+	// Terrain heights for ground clamping - cell size and probe budget can be tuned in the prefs.
+	gTerrainCache.init();
 	
 	// SETUP - mostly just fetch datarefs.
 
 	if (!gCullInfoInitialised) {
 		init_cullinfo();
 	}
+	XPLMDebugString(XPMP_CLIENT_NAME " - culling with the ");
+	XPLMDebugString(cull_kernel_name());
+	XPLMDebugString(" kernel.\n");
 	gVisDataRef = XPLMFindDataRef("sim/graphics/view/visibility_effective_m");
 	if (gVisDataRef == NULL) gVisDataRef = XPLMFindDataRef("sim/weather/visibility_effective_m");
 	if (gVisDataRef == NULL)
@@ -249,20 +204,8 @@ void			XPMPInitDefaultPlaneRenderer(void)
 
 	if(gAltitudeRef == NULL) gAltitudeRef = XPLMFindDataRef("sim/flightmodel/position/elevation");
 
-#if RENDERER_STATS
-	XPLMRegisterDataAccessor("hack/renderer/planes", xplmType_Int, 0, GetRendererStat, NULL,
-							 NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-							 &gTotPlanes, NULL);
-	XPLMRegisterDataAccessor("hack/renderer/navlites", xplmType_Int, 0, GetRendererStat, NULL,
-							 NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-							 &gNavPlanes, NULL);
-	XPLMRegisterDataAccessor("hack/renderer/objects", xplmType_Int, 0, GetRendererStat, NULL,
-							 NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-							 &gOBJPlanes, NULL);
-	XPLMRegisterDataAccessor("hack/renderer/acfs", xplmType_Int, 0, GetRendererStat, NULL,
-							 NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-							 &gACFPlanes, NULL);
-#endif		
+	// Stage timings and plane counts - see XPMPGetRenderStats.
+	gRenderStats.init();		
 
 	// We don't know how many multiplayer planes there are - fetch as many as we can.
     gMultiRef.clear();                  // just a safety measure against multi init
@@ -285,44 +228,154 @@ void			XPMPInitDefaultPlaneRenderer(void)
 		if (!d) break;
 		gMultiRef.push_back(d);
 	}
+
+	gTcasSlots.reset((int)gMultiRef.size());
+
+	for (int i = 0; i < MDR_COUNT; ++i)
+		gTcasArrayRef[i] = XPLMFindDataRef(kTcasArrayNames[i]);
+	gUseTcasArrays = false;
+	gTcasDirtyLo = gTcasDirtyHi = -1;
 }
 
 void XPMPDeinitDefaultPlaneRenderer() {
-	XPLMDestroyProbe(terrainProbe);
+	gTerrainCache.deinit();
+	gRenderStats.deinit();
+}
+
+// Writes one slot's values, touching only what changed since the last write.
+// With the TCAS arrays the slot is just marked dirty and goes out in tcas_flush().
+static void slot_write(int idx, float x, float y, float z, float pitch, float roll, float heading)
+{
+	multiDataRefsTy& mdr = gMultiRef[idx];
+	const float v[MDR_COUNT] = { x, y, z, pitch, roll, heading };
+	bool dirty = false;
+	for (int i = 0; i < MDR_COUNT; ++i)
+	{
+		if (mdr.bValid && mdr.written[i] == v[i])
+			continue;
+		mdr.written[i] = v[i];
+		dirty = true;
+		if (!gUseTcasArrays)
+		{
+			switch (i) {
+			case MDR_X:			XPLMSetDataf(mdr.X, v[i]);			break;
+			case MDR_Y:			XPLMSetDataf(mdr.Y, v[i]);			break;
+			case MDR_Z:			XPLMSetDataf(mdr.Z, v[i]);			break;
+			case MDR_PITCH:		XPLMSetDataf(mdr.pitch, v[i]);		break;
+			case MDR_ROLL:		XPLMSetDataf(mdr.roll, v[i]);		break;
+			case MDR_HEADING:	XPLMSetDataf(mdr.heading, v[i]);	break;
+			}
+		}
+	}
+	mdr.bValid = true;
+	if (dirty && gUseTcasArrays)
+	{
+		if (gTcasDirtyLo < 0 || idx < gTcasDirtyLo) gTcasDirtyLo = idx;
+		if (idx > gTcasDirtyHi) gTcasDirtyHi = idx;
+	}
+}
+
+// Moves a free slot out of the way - once, parked slots are not written again.
+static void slot_park(int idx)
+{
+	multiDataRefsTy& mdr = gMultiRef[idx];
+	if (mdr.bValid && mdr.bParked)
+		return;
+	slot_write(idx, FAR_AWAY_VAL_GL, FAR_AWAY_VAL_GL, FAR_AWAY_VAL_GL, 0.0f, 0.0f, 0.0f);
+	mdr.bParked = true;
+}
+
+// Sends the dirty slot range of each TCAS array in one go.
+static void tcas_flush()
+{
+	if (gTcasDirtyLo < 0)
+		return;
+	const int n = gTcasDirtyHi - gTcasDirtyLo + 1;
+	gTcasArrayBuf.resize(n);
+	for (int i = 0; i < MDR_COUNT; ++i)
+	{
+		for (int k = 0; k < n; ++k)
+			gTcasArrayBuf[k] = gMultiRef[gTcasDirtyLo + k].written[i];
+		XPLMSetDatavf(gTcasArrayRef[i], gTcasArrayBuf.data(), gTcasDirtyLo + 1, n);
+	}
+	gTcasDirtyLo = gTcasDirtyHi = -1;
+}
+
+// The arrays are only usable if all six are there, writable, and big enough for
+// every slot we know (they include the user's plane at index 0).
+static bool tcas_arrays_usable()
+{
+	for (int i = 0; i < MDR_COUNT; ++i)
+		if (!gTcasArrayRef[i] || !XPLMCanWriteDataRef(gTcasArrayRef[i]) ||
+			XPLMGetDatavf(gTcasArrayRef[i], NULL, 0, 0) < (int)gMultiRef.size() + 1)
+			return false;
+	return true;
+}
+
+// Gives up the plane's TCAS slot, if it has one.  The slot is parked with the next plan.
+void XPMPReleaseTcasSlot(XPMPPlanePtr inPlane)
+{
+	int& multiIdx = gPlanes.hot().multiIdx[gPlanes.indexOf(inPlane)];
+	if (multiIdx >= 0 && multiIdx < gTcasSlots.size() &&
+		gTcasSlots.owner(multiIdx) == inPlane)
+		gTcasSlots.release(multiIdx);
+	multiIdx = -1;
+	inPlane->slotGraceFrames = 0;
+}
+
+// all slots become free
+static void release_all_tcas_slots()
+{
+	for (int i = 0; i < gTcasSlots.size(); ++i)
+		if (gTcasSlots.taken(i))
+			XPMPReleaseTcasSlot(gTcasSlots.owner(i));
 }
 
 // reset all (controlled) multiplayer dataRef values
 void XPMPInitMultiplayerDataRefs() {
+    release_all_tcas_slots();
     if (gHasControlOfAIAircraft)
-        for (multiDataRefsTy& mdr : gMultiRef)
+    {
+        // we've just (re)acquired the planes: find out how to write, forget
+        // what we think is in there and park every slot for real
+        gUseTcasArrays = tcas_arrays_usable();
+        gTcasDirtyLo = gTcasDirtyHi = -1;
+        for (size_t i = 0; i < gMultiRef.size(); ++i)
         {
-            mdr.bSlotTaken = false;
-            XPLMSetDataf(mdr.X, FAR_AWAY_VAL_GL);
-            XPLMSetDataf(mdr.Y, FAR_AWAY_VAL_GL);
-            XPLMSetDataf(mdr.Z, FAR_AWAY_VAL_GL);
-            XPLMSetDataf(mdr.pitch, 0.0f);
-            XPLMSetDataf(mdr.roll, 0.0f);
-            XPLMSetDataf(mdr.heading, 0.0f);
+            gMultiRef[i].bValid = false;
+            slot_park((int)i);
         }
+        tcas_flush();
+    }
 }
 
-/* correctYValue returns the clamped Z value given the input X, Y and Z and the
- * known vertical offset of the aircraft model.
+// park all slots, but only write those that aren't parked already
+static void XPMPParkMultiplayerDataRefs() {
+    release_all_tcas_slots();
+    if (gHasControlOfAIAircraft)
+    {
+        for (size_t i = 0; i < gMultiRef.size(); ++i)
+            slot_park((int)i);
+        tcas_flush();
+    }
+}
+
+/* correctYValue returns the clamped Y value given the input X, Y and Z and the
+ * known vertical offset of the aircraft model.  Terrain heights come from the
+ * terrain cache; ioMemo is the plane's own memory of its last probe.
 */
-double
-correctYValue(double inX, double inY, double inZ, double inModelYOffset)
+static double
+correctYValue(double inX, double inY, double inZ, double inModelYOffset, TerrainProbeMemo &ioMemo)
 {
-	XPLMProbeInfo_t info;
-	info.structSize = sizeof(XPLMProbeInfo_t);
-	XPLMProbeResult res = XPLMProbeTerrainXYZ(terrainProbe,
-		static_cast<float>(inX),
-		static_cast<float>(inY),
-		static_cast<float>(inZ),
-		&info);
-	if (res != xplm_ProbeHitTerrain) {
+	RenderStageTimer timer(xpmpStage_TerrainProbe);
+	float terrainY;
+	if (!gTerrainCache.terrainHeight(static_cast<float>(inX),
+									 static_cast<float>(inY),
+									 static_cast<float>(inZ),
+									 ioMemo, terrainY)) {
 		return inY;
 	}
-	double minY = info.locationY + inModelYOffset;
+	double minY = terrainY + inModelYOffset;
 	return (inY < minY) ? minY : inY;
 }
 
@@ -330,72 +383,104 @@ correctYValue(double inX, double inY, double inZ, double inModelYOffset)
 // we use this struct to remember one visible plane.  Once we've
 // found all visible planes, we draw the closest ones.
 
+// Position, attitude and draw state are in the plane's hot store row.
 struct	PlaneToRender_t {
-	float					x;			// Positional info
-	float					y;
-	float					z;
+	uint32_t				row;		// in gPlanes.hot()
 	XPMPPlanePtr			plane;
 	bool					full;		// Do we need to draw the full plane or just lites?
 	bool					cull;		// Are we visible on screen?
 	bool					tcas;		// Are we visible on TCAS?
-	XPLMPlaneDrawState_t	state;		// Flaps, gear, etc.
 	float					dist;
+	OBJ_DrawPrep_t			objPrep;	// OBJ7 only: LOD and textures picked at cull time
 };
-typedef	std::map<float, PlaneToRender_t>	RenderMap;
 
+// The render list is a flat array that lives across frames - we clear it each
+// frame but keep its capacity, so after the first few frames we don't allocate
+// at all.  Nothing is keyed by distance anymore; when we need the closest N planes
+// (full planes, TCAS) we do a partial selection on an array of pointers into it.
+typedef std::vector<PlaneToRender_t>		RenderList;
+typedef std::vector<PlaneToRender_t *>		RenderPtrList;
+
+static RenderList							gRenderList;
+static RenderPtrList						gFullCandidates;	// visible planes that want to be drawn in full
+static RenderPtrList						gTcasCandidates;	// planes that want to show up on TCAS
+static DrawQueue							gDrawQueue;			// every visible plane, sorted by pass and GL state
+static cull_buffer_t						gCullBuffer;		// SoA positions for the batch culling kernel
+static std::vector<uint32_t>				gCullRows;			// the hot store row for each cull buffer entry
+static std::vector<XPMPPlaneSurfaces_t>	gRowSurfaces;		// by hot store row, what the data pull fetched
+static std::vector<XPMPPlaneRadar_t>		gRowRadar;
+static cull_buffer_t						gPlanBuffer;		// final positions of gRenderList, same order
+static cull_buffer_t						gLabelBuffer;		// label anchors, projected in one batch
+static RenderPtrList						gLabelPlanes;
+static std::vector<float>					gLabelScreenX;
+static std::vector<float>					gLabelScreenY;
+static std::vector<size_t>					gLabelOrder;		// label indices, nearest first
+static LabelDeclutter						gLabelDeclutter;
+
+// The render plan: X-Plane calls us once for the solid pass, once for the blend
+// pass and possibly again for shadows (and twice each in VR).  Everything that
+// does not depend on the camera - pulling plane data, world-to-local, state,
+// vertical offsets, ground clamping and TCAS - is done once per sim cycle.  The
+// camera-dependent part - culling, LOD and bucketing - is redone only when a pass
+// comes along with different matrices than the last one.
+struct RenderPlan_t {
+	int						cycle = -1;			// XPLMGetCycleNumber() the plan was built for, -1 = invalid
+	int						modelCount = 0;		// Austin's loaded models at build time
+	bool					culled = false;		// buckets are valid for 'camera'
+	cull_info_t				camera;				// the matrices the buckets were computed with
+};
+static RenderPlan_t							gPlan;
 
-void			XPMPDefaultPlaneRenderer(int is_blend)
+static bool render_dist_less(const PlaneToRender_t * a, const PlaneToRender_t * b)
 {
-	long	planeCount = XPMPCountPlanes();
-#if DEBUG_RENDERER
-	char	buf[50];
-	sprintf(buf,"Renderer Planes: %d\n", planeCount);
-	XPLMDebugString(buf);
-#endif
-	if (planeCount == 0)		// Quick exit if no one's around.
-	{
-        // make sure multiplayer dataRefs are cleaned
-        XPMPInitMultiplayerDataRefs();
-        
-		if (gDumpOneRenderCycle)
-		{
-			gDumpOneRenderCycle = false;
-			XPLMDebugString("No planes this cycle.\n");
-		}
-		return;
-	}
-
-	if (!gMSAAHackInitialised) {
-		gMSAAHackInitialised = true;
-		gMSAAXRatioRef = XPLMFindDataRef("sim/private/controls/hdr/fsaa_ratio_x");
-		gMSAAYRatioRef = XPLMFindDataRef("sim/private/controls/hdr/fsaa_ratio_y");
-        gHDROnRef      = XPLMFindDataRef("sim/graphics/settings/HDR_on");
-	}
+	return a->dist < b->dist;
+}
 
-	cull_info_t			gl_camera;
-	setup_cull_info(&gl_camera);
-	XPLMCameraPosition_t x_camera;
+// Reduce the candidate list to the closest 'n' entries (order among them unspecified)
+// and return the ones that didn't make it, so the caller can demote them.
+static RenderPtrList::iterator select_closest(RenderPtrList& candidates, size_t n)
+{
+	if (candidates.size() <= n)
+		return candidates.end();
+	std::nth_element(candidates.begin(), candidates.begin() + n, candidates.end(), render_dist_less);
+	return candidates.begin() + n;
+}
 
-	XPLMReadCameraPosition(&x_camera);	// only for zoom!
+static bool same_camera(const cull_info_t& a, const cull_info_t& b)
+{
+	return	memcmp(a.model_view, b.model_view, sizeof(a.model_view)) == 0 &&
+			memcmp(a.proj, b.proj, sizeof(a.proj)) == 0;
+}
 
-	// Culling - read the camera pos«and figure out what's visible.
+void XPMPInvalidateRenderPlan()
+{
+	gPlan.cycle = -1;
+	gPlan.culled = false;
+	gRenderList.clear();
+}
 
-	double	maxDist = XPLMGetDataf(gVisDataRef);
-	double  labelDist = min(maxDist, MAX_LABEL_DIST) * x_camera.zoom;		// Labels get easier to see when users zooms.
-	double	fullPlaneDist = x_camera.zoom * (5280.0 / 3.2) * (gFloatPrefsFunc ? gFloatPrefsFunc("planes","full_distance", 3.0) : 3.0);	// Only draw planes fully within 3 miles.
-	int		maxFullPlanes = gIntPrefsFunc ? gIntPrefsFunc("planes","max_full_count", 100) : 100;						// Draw no more than 100 full planes!
+/************************************************************************************
+ * BUILDING THE PLAN - once per cycle
+ ************************************************************************************/
 
-	gTotPlanes = (int)planeCount;
-	gNavPlanes = gACFPlanes = gOBJPlanes = 0;
+static void build_render_plan(const cull_info_t& gl_camera, long planeCount, double maxDist, int cycle)
+{
+	gRenderStats.planes = (int)planeCount;
 
 	int modelCount, active, plugin;
 	XPLMCountAircraft(&modelCount, &active, &plugin);
 
-	RenderMap						myPlanes;		// Planes - sorted by distance so we can do the closest N and bail
-	
-	/************************************************************************************
-	 * CULLING AND STATE CALCULATION LOOP
-	 ************************************************************************************/
+	gPlan.cycle = cycle;
+	gPlan.modelCount = modelCount;
+	gPlan.culled = false;
+
+	gRenderList.clear();
+	gRenderList.reserve(planeCount);	// pointers into the list must stay valid once we start bucketing
+
+	gTerrainCache.setCellSize(gPrefs.terrain_cell_size);
+	gTerrainCache.setMotionThreshold(gPrefs.terrain_motion_threshold);
+	gTerrainCache.setMaxProbesPerFrame(gPrefs.terrain_probes_per_frame);
+	gTerrainCache.beginFrame();
 	
 	if (gDumpOneRenderCycle)
 	{
@@ -413,304 +498,481 @@ void			XPMPDefaultPlaneRenderer(int is_blend)
 		}
 	}
 	
-	// Go through every plane.  We're going to figure out if it is visible and if so remember it for drawing later.
-	for (long index = 0; index < planeCount; ++index)
+	// First pull every plane's data from the client - position, surfaces and radar are
+	// cached in the plane for this cycle - then convert the positions to local coordinates
+	// into the cull buffer and run the batch kernel over all of them at once for the distances.
+	PlaneHotStore& hot = gPlanes.hot();
+	gCullRows.clear();
+	gRowSurfaces.resize(planeCount);
+	gRowRadar.resize(planeCount);
 	{
-		XPMPPlanePtr id = static_cast<XPMPPlanePtr>(XPMPGetNthPlane(index));
-		
-		XPMPPlanePosition_t	pos;
-		pos.size = sizeof(pos);
-		pos.label[0] = 0;
-
-		if (XPMPGetPlaneData(id, xpmpDataType_Position, &pos) != xpmpData_Unavailable)
+		RenderStageTimer timer(xpmpStage_DataPull);
+		for (long index = 0; index < planeCount; ++index)
 		{
-			// First figure out where the plane is!
+			XPMPPlanePtr id = hot.plane[index];
+			hot.flags[index] = 0;
 
-			double	x,y,z;
-			XPLMWorldToLocal(pos.lat, pos.lon, pos.elevation * kFtToMeters, &x, &y, &z);
-			
-			float distMeters = sqrt(sphere_distance_sqr(&gl_camera,
-														static_cast<float>(x),
-														static_cast<float>(y),
-														static_cast<float>(z)));
-			
-			// If the plane is farther than our TCAS range, it's just not visible.  Drop it!
-            if (distMeters > kMaxDistTCAS) {
-                id->multiIdx = -1;
+			XPMPPlanePosition_t	pos;
+			pos.size = sizeof(pos);
+			pos.label[0] = 0;
+			if (XPMPFetchPlaneData(id, xpmpDataType_Position, &pos) == xpmpData_Unavailable)
 				continue;
-            }
 
-			// Only draw if it's in range.
-			bool cull = (distMeters > maxDist);
-			
-			XPMPPlaneRadar_t radar;
+			// kept for the loop below - asking the client again would run its callback twice
+			uint8_t flags = hot_Position | ((pos.clampToGround || gPrefs.clamp_all_to_ground) ? hot_ClampToGround : 0);
+			XPMPPlaneSurfaces_t& surfaces = gRowSurfaces[index];
+			surfaces.size = sizeof(surfaces);
+			if (XPMPFetchPlaneData(id, xpmpDataType_Surfaces, &surfaces) != xpmpData_Unavailable)
+				flags |= hot_Surfaces;
+			XPMPPlaneRadar_t& radar = gRowRadar[index];
 			radar.size = sizeof(radar);
-			bool tcas = true;
-			if (XPMPGetPlaneData(id, xpmpDataType_Radar, &radar) != xpmpData_Unavailable)
-				if (radar.mode == xpmpTransponderMode_Standby)
-					tcas = false;
-
-			// check for altitude - if difference exceeds a preconfigured limit, don't show
-			double acft_alt = XPLMGetDatad(gAltitudeRef) / kFtToMeters;
-			double alt_diff = pos.elevation - acft_alt;
-			if(alt_diff < 0) alt_diff *= -1;
-			if(alt_diff > MAX_TCAS_ALTDIFF) tcas = false;
-
-			// Calculate the heading from the camera to the target (hor, vert).
-			// Calculate the angles between the camera angles and the real angles.
-			// Cull if we exceed half the FOV.
-			
-			if(!cull && !sphere_is_visible(&gl_camera, static_cast<float>(x),
-										   static_cast<float>(y),
-										   static_cast<float>(z), 50.0))
-			{
-				cull = true;
-			}
-			
-			// Full plane or lites based on distance.
-			bool	drawFullPlane = (distMeters < fullPlaneDist);
-			
-#if DEBUG_RENDERER
+			if (XPMPFetchPlaneData(id, xpmpDataType_Radar, &radar) != xpmpData_Unavailable)
+				flags |= hot_Radar;
+
+			// from here on the plan only looks at the hot store (and the rows above)
+			hot.lat[index] = pos.lat;
+			hot.lon[index] = pos.lon;
+			hot.elevation[index] = pos.elevation;
+			hot.pitch[index] = pos.pitch;
+			hot.roll[index] = pos.roll;
+			hot.heading[index] = pos.heading;
+			hot.model[index] = id->model;
+			hot.flags[index] = flags;
+			gCullRows.push_back(static_cast<uint32_t>(index));
+		}
+	}
+	gCullBuffer.clear();
+	{
+		RenderStageTimer timer(xpmpStage_WorldToLocal);
+		for (uint32_t row : gCullRows)
+		{
+			// First figure out where the plane is!
+			double	x,y,z;
+			XPLMWorldToLocal(hot.lat[row], hot.lon[row], hot.elevation[row] * kFtToMeters, &x, &y, &z);
+			gCullBuffer.push_back(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z));
+		}
+	}
+	{
+		RenderStageTimer timer(xpmpStage_Cull);
+		cull_spheres(gl_camera, 50.0f, gCullBuffer);
+	}
+
+	const double acft_alt = XPLMGetDatad(gAltitudeRef) / kFtToMeters;
 
-			char	icao[128], livery[128];
-			char	debug[512];
+	// Go through every plane.  We're going to figure out its state and where exactly it sits.
+	for (size_t index = 0; index < gCullBuffer.count; ++index)
+	{
+		const uint32_t row = gCullRows[index];
+		XPMPPlanePtr id = hot.plane[row];
+
+		float distMeters = sqrt(gCullBuffer.dist_sqr[index]);
+		
+		// If the plane is farther than our TCAS range, it's just not visible.  Drop it!
+		if (distMeters > kMaxDistTCAS) {
+			XPMPReleaseTcasSlot(id);
+			continue;
+		}
+
+		bool tcas = true;
+		if (hot.flags[row] & hot_Radar)
+			if (gRowRadar[row].mode == xpmpTransponderMode_Standby)
+				tcas = false;
 
-			XPMPGetPlaneICAOAndLivery(id, icao, livery);
-			sprintf(debug,"Queueing plane %d (%s/%s) at lle %f, %f, %f (xyz=%f, %f, %f) pitch=%f,roll=%f,heading=%f,model=1.\n", index, icao, livery,
-					pos.lat, pos.lon, pos.elevation,
-					x, y, z, pos.pitch, pos.roll, pos.heading);
-			XPLMDebugString(debug);
+		// check for altitude - if difference exceeds a preconfigured limit, don't show
+		double alt_diff = hot.elevation[row] - acft_alt;
+		if(alt_diff < 0) alt_diff *= -1;
+		if(alt_diff > MAX_TCAS_ALTDIFF) tcas = false;
+
+#if DEBUG_RENDERER
+		char	icao[128], livery[128];
+		char	debug[512];
+
+		XPMPGetPlaneICAOAndLivery(id->id, icao, livery);
+		sprintf(debug,"Queueing plane %d (%s/%s) at lle %f, %f, %f (xyz=%f, %f, %f) pitch=%f,roll=%f,heading=%f,model=1.\n", (int)index, icao, livery,
+				hot.lat[row], hot.lon[row], hot.elevation[row],
+				gCullBuffer.x[index], gCullBuffer.y[index], gCullBuffer.z[index], hot.pitch[row], hot.roll[row], hot.heading[row]);
+		XPLMDebugString(debug);
 #endif
-            // Not on TCAS? Then it occupies no multiplayer idx
-            if (!tcas)
-                id->multiIdx = -1;
+		// Not on TCAS? Then it occupies no multiplayer idx
+		if (!tcas)
+			XPMPReleaseTcasSlot(id);
+
+		// Stash one render record with the plane's position, etc.
+		PlaneToRender_t		renderRecord;
+		float x = gCullBuffer.x[index];
+		float y = gCullBuffer.y[index];
+		float z = gCullBuffer.z[index];
+		renderRecord.row = row;
+		renderRecord.plane = id;
+		renderRecord.cull = (distMeters > maxDist);		// refined per camera in cull_render_plan
+		renderRecord.tcas = tcas;
+		renderRecord.full = false;
+		renderRecord.dist = distMeters;
+
+		XPLMPlaneDrawState_t& state = hot.state[row];
+		if (hot.flags[row] & hot_Surfaces)
+		{
+			const XPMPPlaneSurfaces_t& surfaces = gRowSurfaces[row];
+			state.structSize = sizeof(state);
+			state.gearPosition 		= surfaces.gearPosition 	;
+			state.flapRatio 		= surfaces.flapRatio 		;
+			state.spoilerRatio 		= surfaces.spoilerRatio 	;
+			state.speedBrakeRatio 	= surfaces.speedBrakeRatio 	;
+			state.slatRatio 		= surfaces.slatRatio 		;
+			state.wingSweep 		= surfaces.wingSweep 		;
+			state.thrust 			= surfaces.thrust 			;
+			state.yokePitch 		= surfaces.yokePitch 		;
+			state.yokeHeading 		= surfaces.yokeHeading 		;
+			state.yokeRoll 			= surfaces.yokeRoll 		;
+		} else {
+			state.structSize = sizeof(state);
+			state.gearPosition = (hot.elevation[row] < 70) ?  1.0f : 0.0f;
+			state.flapRatio = (hot.elevation[row] < 70) ? 1.0f : 0.0f;
+			state.spoilerRatio = state.speedBrakeRatio = state.slatRatio = state.wingSweep = 0.0;
+			state.thrust = (hot.pitch[row] > 30) ? 1.0f : 0.6f;
+			state.yokePitch = hot.pitch[row] / 90.0f;
+			state.yokeHeading = hot.heading[row] / 180.0f;
+			state.yokeRoll = hot.roll[row] / 90.0f;
+
+			// use some smart defaults
+			id->surface.lights.bcnLights = 1;
+			id->surface.lights.navLights = 1;
+		}
+		hot.lights[row] = id->surface.lights;
 
-			// Stash one render record with the plane's position, etc.
+		CSLPlane_t * model = hot.model[row];
+		if (model)
+		{
+			if (!model->moving_gear)
+				id->surface.gearPosition = 1.0;
+
+			// Vertical offset and ground clamping - only for planes within visibility,
+			// nobody is going to see the others and the terrain probe isn't free.
+			if (!renderRecord.cull)
 			{
-				PlaneToRender_t		renderRecord;
-				renderRecord.x = static_cast<float>(x);
-				renderRecord.y = static_cast<float>(y);
-				renderRecord.z = static_cast<float>(z);
-				renderRecord.plane = static_cast<XPMPPlanePtr>(id);
-				renderRecord.cull = cull;						// NO other planes.  Doing so causes a lot of things to go nuts!
-				renderRecord.tcas = tcas;
-
-				XPMPPlaneSurfaces_t	surfaces;
-				surfaces.size = sizeof(surfaces);
-				if (XPMPGetPlaneData(id, xpmpDataType_Surfaces, &surfaces) != xpmpData_Unavailable)
-				{
-					renderRecord.state.structSize = sizeof(renderRecord.state);
-					renderRecord.state.gearPosition 	= surfaces.gearPosition 	;
-					renderRecord.state.flapRatio 		= surfaces.flapRatio 		;
-					renderRecord.state.spoilerRatio 	= surfaces.spoilerRatio 	;
-					renderRecord.state.speedBrakeRatio 	= surfaces.speedBrakeRatio 	;
-					renderRecord.state.slatRatio 		= surfaces.slatRatio 		;
-					renderRecord.state.wingSweep 		= surfaces.wingSweep 		;
-					renderRecord.state.thrust 			= surfaces.thrust 			;
-					renderRecord.state.yokePitch 		= surfaces.yokePitch 		;
-					renderRecord.state.yokeHeading 		= surfaces.yokeHeading 		;
-					renderRecord.state.yokeRoll 		= surfaces.yokeRoll 		;
-				} else {
-					renderRecord.state.structSize = sizeof(renderRecord.state);
-					renderRecord.state.gearPosition = (pos.elevation < 70) ?  1.0f : 0.0f;
-					renderRecord.state.flapRatio = (pos.elevation < 70) ? 1.0f : 0.0f;
-					renderRecord.state.spoilerRatio = renderRecord.state.speedBrakeRatio = renderRecord.state.slatRatio = renderRecord.state.wingSweep = 0.0;
-					renderRecord.state.thrust = (pos.pitch > 30) ? 1.0f : 0.6f;
-					renderRecord.state.yokePitch = pos.pitch / 90.0f;
-					renderRecord.state.yokeHeading = pos.heading / 180.0f;
-					renderRecord.state.yokeRoll = pos.roll / 90.0f;
-
-					// use some smart defaults
-					renderRecord.plane->surface.lights.bcnLights = 1;
-					renderRecord.plane->surface.lights.navLights = 1;
+				RenderStageTimer timer(xpmpStage_VertOffset);
+				// always check for the offset since we need it in multiple places.
+				cslVertOffsetCalc.findOrUpdateActualVertOffset(*model);
+				if (id->pos.offsetScale > 0.0f) {
+					y += id->pos.offsetScale * float(model->actualVertOffset);
 				}
-				if (renderRecord.plane->model && !renderRecord.plane->model->moving_gear)
-					renderRecord.plane->surface.gearPosition = 1.0;
-				renderRecord.full = drawFullPlane;
-				renderRecord.dist = distMeters;
-				myPlanes.insert(RenderMap::value_type(distMeters, renderRecord));
-
-			} // State calculation
-			
-		} // Plane has data available
-		
+				if (hot.flags[row] & hot_ClampToGround) {
+					//correct y value by real terrain elevation
+					y = (float)correctYValue(x, y, z, model->actualVertOffset, id->terrainMemo);
+				}
+			}
+		}
+		hot.x[row] = x;
+		hot.y[row] = y;
+		hot.z[row] = z;
+		gRenderList.push_back(renderRecord);
 	} // Per-plane loop
 
 	if (gDumpOneRenderCycle)
 		XPLMDebugString("End of cycle dump.\n");
-    
-    /************************************************************************************
-     * Prepare multiplayer indexes
-     ************************************************************************************/
 
-    // We want a plane to keep its index as long as it shows. The eases following it
-    // from other plugins (TCAS, maps...etc)
-    // The plane's multiplayer idx is in XPMPPlane_t::multiIdx
-    if (gHasControlOfAIAircraft)
-    {
-        // reset our bookkeeping on used multiplay idx
-        for (multiDataRefsTy& iter: gMultiRef)
-            iter.bSlotTaken = false;
-        
-        // run over all known planes in order of distance(!) and set those multiplayer idx used, which are takem
-        int numTcasPlanes = 0;
-        for (RenderMap::iterator iter = myPlanes.begin();
-             iter != myPlanes.end() && numTcasPlanes < gMultiRef.size();      // at most as often as we found TCAS-relevant planes
-             ++iter)
-        {
-            if (iter->second.tcas) {                                // TCAS relevant?
-                XPMPPlanePtr p = iter->second.plane;
-                if (p->multiIdx >= 0 &&
-                    p->multiIdx < gMultiRef.size())
-                    gMultiRef[p->multiIdx].bSlotTaken = true;       // has a 'resevred' multiplayer idx
-                numTcasPlanes++;                                  // one more TCAS plane found
-            }
-        }
-    }
-	
+	// The final positions are what every pass culls against.
+	gPlanBuffer.clear();
+	for (const PlaneToRender_t& rec : gRenderList)
+		gPlanBuffer.push_back(hot.x[rec.row], hot.y[rec.row], hot.z[rec.row]);
+
 	/************************************************************************************
-	 * ACTUAL RENDERING LOOP
+	 * Pick the closest TCAS planes and move Austin's planes for them
 	 ************************************************************************************/
+
+	// We want a plane to keep its index as long as it shows. The eases following it
+	// from other plugins (TCAS, maps...etc)
+	// The plane's multiplayer idx is in its hot store row, gTcasSlots knows the owner
+	// of each slot.  The closest gMultiRef.size() TCAS planes qualify for a slot, nearest
+	// first.  A plane that drops just behind the cut-off keeps its slot for a while
+	// (tcas_slot_hysteresis_dist / _frames) so that planes at the edge don't trade slots
+	// every frame.
+	RenderStageTimer tcasTimer(xpmpStage_TCAS);
+	gTcasCandidates.clear();
+	for (PlaneToRender_t& rec : gRenderList)
+		if (rec.tcas)
+			gTcasCandidates.push_back(&rec);
+
+	if (gHasControlOfAIAircraft)
+	{
+		const size_t numTcasPlanes = std::min(gTcasCandidates.size(), gMultiRef.size());
+		std::partial_sort(gTcasCandidates.begin(), gTcasCandidates.begin() + numTcasPlanes,
+						  gTcasCandidates.end(), render_dist_less);
+		const float keepDist = 0 < numTcasPlanes && numTcasPlanes < gTcasCandidates.size() ?
+			gTcasCandidates[numTcasPlanes - 1]->dist + gPrefs.tcas_slot_hysteresis_dist : 0.0f;
+
+		// behind the cut-off: hang on to a slot within the hysteresis, else give it up
+		for (size_t i = numTcasPlanes; i < gTcasCandidates.size(); ++i)
+		{
+			PlaneToRender_t& rec = *gTcasCandidates[i];
+			const int multiIdx = hot.multiIdx[rec.row];
+			if (multiIdx < 0)
+				continue;
+			if (rec.dist <= keepDist &&
+				++rec.plane->slotGraceFrames <= gPrefs.tcas_slot_hysteresis_frames)
+			{
+				rec.plane->tcasCycle = cycle;
+				slot_write(multiIdx, hot.x[rec.row], hot.y[rec.row], hot.z[rec.row],
+						   hot.pitch[rec.row], hot.roll[rec.row], hot.heading[rec.row]);
+				gMultiRef[multiIdx].bParked = false;
+			}
+			else
+				XPMPReleaseTcasSlot(rec.plane);
+		}
+
+		// TCAS handling - if the plane needs to be drawn on TCAS and we haven't yet, move one of Austin's planes.
+		// (if planes in their grace period still hold all slots, newcomers wait)
+		for (size_t i = 0; i < numTcasPlanes; ++i)
+		{
+			PlaneToRender_t& rec = *gTcasCandidates[i];
+			int& multiIdx = hot.multiIdx[rec.row];
+			rec.plane->slotGraceFrames = 0;
+			if (multiIdx < 0)
+				multiIdx = gTcasSlots.acquire(rec.plane);
+			if (multiIdx < 0)
+				continue;
+			rec.plane->tcasCycle = cycle;
+			slot_write(multiIdx, hot.x[rec.row], hot.y[rec.row], hot.z[rec.row],
+					   hot.pitch[rec.row], hot.roll[rec.row], hot.heading[rec.row]);
+			gMultiRef[multiIdx].bParked = false;
+		}
+
+		// owners that didn't show up this cycle (no position, ...) lose their slot
+		for (int i = 0; i < gTcasSlots.size(); ++i)
+			if (gTcasSlots.taken(i) && gTcasSlots.owner(i)->tcasCycle != cycle)
+				XPMPReleaseTcasSlot(gTcasSlots.owner(i));
+	}
+
+	// Final hack - leave a note to ourselves for how many of Austin's planes we relocated to do TCAS.
+	gEnableCount = std::max(gTcasSlots.used(), 1);
+	// As some plugins don't consider XPLMCountAircraft let's cleanup unused multiplayer datarefs
+	// (only slots that just became free are actually written)
+	if (gHasControlOfAIAircraft) {
+		for (int i = 0; i < gTcasSlots.size(); ++i)
+			if (!gTcasSlots.taken(i))
+				slot_park(i);
+		tcas_flush();
+	} else {
+		release_all_tcas_slots();
+	}
 	
-	// We're going to go in and render the first N planes in full, and the rest as lites.
-	// We're also going to put the x-plane multiplayer vars in place for the first N
-	// TCAS-visible planes, so they show up on our moving map.
-	// We do this in two stages: building up what to do, then doing it in the optimal
-	// OGL order.
-	
-	size_t	renderedCounter = 0;
-    int     maxMultiIdxUsed = 0;
+	gDumpOneRenderCycle = 0;
+}
 
-	vector<PlaneToRender_t *>			planes_obj_lites;
-	multimap<int, PlaneToRender_t *>	planes_austin;
-	vector<PlaneToRender_t *>			planes_obj;
-	vector<PlaneToRender_t *>			planes_obj8;
+/************************************************************************************
+ * CULLING AND BUCKETING - once per camera
+ ************************************************************************************/
 
-	vector<PlaneToRender_t *>::iterator			planeIter;
-	multimap<int, PlaneToRender_t *>::iterator	planeMapIter;
+static void cull_render_plan(const cull_info_t& gl_camera, double maxDist, double fullPlaneDist, int maxFullPlanes)
+{
+	RenderStageTimer timer(xpmpStage_Cull);
+	gPlan.camera = gl_camera;
+	gPlan.culled = true;
 
-	// In our first iteration pass we'll go through all planes and handle TCAS, draw planes that have no
-	// CSL model, and put CSL planes in the right 'bucket'.
+	cull_spheres(gl_camera, 50.0f, gPlanBuffer);
+	const PlaneHotStore& hot = gPlanes.hot();
 
-	for (RenderMap::iterator iter = myPlanes.begin(); iter != myPlanes.end(); ++iter)
+	// Max plane enforcement - only the closest max_full_count visible planes are
+	// drawn in full, the rest get lites only for framerate.
+	gFullCandidates.clear();
+	for (size_t index = 0; index < gRenderList.size(); ++index)
 	{
-		// This is the case where we draw a real plane.
-		if (!iter->second.cull)
-		{
-			// Max plane enforcement - once we run out of the max number of full planes the
-			// user allows, force only lites for framerate
-			if (gACFPlanes >= maxFullPlanes)
-				iter->second.full = false;
+		PlaneToRender_t& rec = gRenderList[index];
+		rec.dist = sqrt(gPlanBuffer.dist_sqr[index]);
+		// Only draw if it's in range and on screen.
+		rec.cull = (rec.dist > maxDist) || !gPlanBuffer.is_visible(index);
+		// Full plane or lites based on distance.
+		rec.full = (rec.dist < fullPlaneDist);
+		if (!rec.cull && rec.full)
+			gFullCandidates.push_back(&rec);
+	}
+	for (RenderPtrList::iterator iter = select_closest(gFullCandidates, (size_t)std::max(maxFullPlanes, 0));
+		 iter != gFullCandidates.end(); ++iter)
+		(*iter)->full = false;
+
+	// Put every visible plane into the draw queue, keyed by the pass that draws it and
+	// the OGL state it needs, so each pass draws in the optimal OGL order.
+	gDrawQueue.clear();
+
+	for (size_t index = 0; index < gRenderList.size(); ++index)
+	{
+		PlaneToRender_t& rec = gRenderList[index];
+		if (rec.cull)
+			continue;
 
 #if DEBUG_RENDERER
-			char	debug[512];
-			sprintf(debug,"Drawing plane: %s at %f,%f,%f (%fx%fx%f full=%d\n",
-					iter->second.plane->model ? iter->second.plane->model->file_path.c_str() : "<none>", iter->second.x, iter->second.y, iter->second.z,
-					iter->second.plane->pos.pitch, iter->second.plane->pos.roll, iter->second.plane->pos.heading, iter->second.full ? 1 : 0);
-			XPLMDebugString(debug);
+		char	debug[512];
+		sprintf(debug,"Drawing plane: %s at %f,%f,%f (%fx%fx%f full=%d\n",
+				hot.model[rec.row] ? hot.model[rec.row]->file_path.c_str() : "<none>", hot.x[rec.row], hot.y[rec.row], hot.z[rec.row],
+				hot.pitch[rec.row], hot.roll[rec.row], hot.heading[rec.row], rec.full ? 1 : 0);
+		XPLMDebugString(debug);
 #endif
 
-			if (iter->second.plane->model)
-			{
-				// always check for the offset since we need it in multiple places.
-				cslVertOffsetCalc.findOrUpdateActualVertOffset(*iter->second.plane->model);
-				if (iter->second.plane->pos.offsetScale > 0.0f) {
-					iter->second.y += iter->second.plane->pos.offsetScale * float(iter->second.plane->model->actualVertOffset);
-				}
-				if (iter->second.plane->pos.clampToGround || (gIntPrefsFunc("planes", "clamp_all_to_ground", 0) != 0)) {
-					//correct y value by real terrain elevation
-					//find or update the actual vert offset in the csl model data
-					cslVertOffsetCalc.findOrUpdateActualVertOffset(*iter->second.plane->model);
-					iter->second.y = (float)correctYValue(
-						iter->second.x, iter->second.y, iter->second.z, iter->second.plane->model->actualVertOffset);
-				}
-				if (iter->second.plane->model->plane_type == plane_Austin)
-				{
-					planes_austin.insert(multimap<int, PlaneToRender_t *>::value_type(CSL_GetOGLIndex(iter->second.plane->model), &iter->second));
-				}
-				else if (iter->second.plane->model->plane_type == plane_Obj)
-				{
-					planes_obj.push_back(&iter->second);
-					planes_obj_lites.push_back(&iter->second);
-				}
-				else if(iter->second.plane->model->plane_type == plane_Obj8)
-				{
-					planes_obj8.push_back(&iter->second);
-				}
+		const uint32_t idx = static_cast<uint32_t>(index);
+		CSLPlane_t * model = hot.model[rec.row];
+		if (!model)
+			gDrawQueue.push(draw_make_key(draw_NoModel, 0, 0, 0, 0), idx);
+		else if (model->plane_type == plane_Austin)
+			gDrawQueue.push(draw_make_key(draw_Austin, CSL_GetOGLIndex(model), 0, 0, 0), idx);
+		else if (model->plane_type == plane_Obj)
+		{
+			const float lodDist = rec.full ? rec.dist : max(rec.dist, 10000.0f);
+			if (OBJ_PrepareModel(rec.plane, lodDist, rec.objPrep))
+				gDrawQueue.push(draw_make_key(draw_Obj7, draw_model_id(rec.objPrep.obj),
+											  rec.objPrep.tex, rec.objPrep.lit, rec.objPrep.lod), idx);
+			gDrawQueue.push(draw_make_key(draw_Obj7Lights, 0, 0, 0, 0), idx);
+		}
+		else if (model->plane_type == plane_Obj8)
+			gDrawQueue.push(draw_make_key(draw_Obj8, draw_model_id(model), 0, 0, 0), idx);
+	}
 
-			} else {
-				// If it's time to draw austin's planes but this one
-				// doesn't have a model, we draw anything.
-				glMatrixMode(GL_MODELVIEW);
-				glPushMatrix();
-				glTranslatef(iter->second.x, iter->second.y, iter->second.z);
-				glRotatef(iter->second.plane->pos.heading, 0.0, -1.0, 0.0);
-				glRotatef(iter->second.plane->pos.pitch, 01.0, 0.0, 0.0);
-				glRotatef(iter->second.plane->pos.roll, 0.0, 0.0, -1.0);
-
-				// Safety check - if plane 1 isn't even loaded do NOT draw, do NOT draw plane 0.
-				// Using the user's planes can cause the internal flight model to get f-cked up.
-				// Using a non-loaded plane can trigger internal asserts in x-plane.
-				if (modelCount > 1)
-					if(!is_blend)
-						XPLMDrawAircraft(1,
-										 (float) iter->second.x, (float) iter->second.y, (float) iter->second.z,
-										 iter->second.plane->pos.pitch, iter->second.plane->pos.roll, iter->second.plane->pos.heading,
-										 iter->second.full ? 1 : 0, &iter->second.state);
-
-				glPopMatrix();
-			}
+	gDrawQueue.sort();
+}
 
+// Moves the coordinate system to the plane - pair with glPopMatrix.
+static void push_plane_matrix(const PlaneHotStore& hot, uint32_t row)
+{
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glTranslatef(hot.x[row], hot.y[row], hot.z[row]);
+	glRotatef(hot.heading[row], 0.0, -1.0, 0.0);
+	glRotatef(hot.pitch[row], 01.0, 0.0, 0.0);
+	glRotatef(hot.roll[row], 0.0, 0.0, -1.0);
+}
+
+/************************************************************************************
+ * ACTUAL RENDERING - every pass, only the queue ranges this pass draws
+ ************************************************************************************/
+
+void			XPMPDefaultPlaneRenderer(int is_blend)
+{
+	long	planeCount = XPMPCountPlanes();
+#if DEBUG_RENDERER
+	char	buf[50];
+	sprintf(buf,"Renderer Planes: %d\n", planeCount);
+	XPLMDebugString(buf);
+#endif
+	if (planeCount == 0)		// Quick exit if no one's around.
+	{
+        // make sure multiplayer dataRefs are cleaned
+        XPMPParkMultiplayerDataRefs();
+        XPMPInvalidateRenderPlan();
+        
+		if (gDumpOneRenderCycle)
+		{
+			gDumpOneRenderCycle = false;
+			XPLMDebugString("No planes this cycle.\n");
 		}
+		return;
+	}
 
-		// TCAS handling - if the plane needs to be drawn on TCAS and we haven't yet, move one of Austin's planes.
-		if (iter->second.tcas && renderedCounter < gMultiRef.size() && gHasControlOfAIAircraft)
+	RenderStageTimer totalTimer(xpmpStage_Total);
+
+	if (!gMSAAHackInitialised) {
+		gMSAAHackInitialised = true;
+		gMSAAXRatioRef = XPLMFindDataRef("sim/private/controls/hdr/fsaa_ratio_x");
+		gMSAAYRatioRef = XPLMFindDataRef("sim/private/controls/hdr/fsaa_ratio_y");
+        gHDROnRef      = XPLMFindDataRef("sim/graphics/settings/HDR_on");
+	}
+
+	cull_info_t			gl_camera;
+	setup_cull_info(&gl_camera);
+	XPLMCameraPosition_t x_camera;
+
+	XPLMReadCameraPosition(&x_camera);	// only for zoom!
+
+	// Culling - read the camera pos«and figure out what's visible.
+
+	const int cycle = XPLMGetCycleNumber();
+	// Not gPlan.cycle - invalidating the plan mid-frame mustn't end the stats frame.
+	static int sStatsCycle = -1;
+	if (sStatsCycle != cycle)
+	{
+		// A new cycle - what we timed and counted so far belongs to the frame before,
+		// and that is what the adaptive detail reacts to, once a frame.
+		sStatsCycle = cycle;
+		gRenderStats.endFrame();
+		gLodBudget.update(gRenderStats.lastFrameRenderUs());
+		gRenderStats.lodLevel = gLodBudget.level();
+	}
+
+	double	maxDist = XPLMGetDataf(gVisDataRef);
+	double  labelDist = min(maxDist, MAX_LABEL_DIST) * x_camera.zoom;		// Labels get easier to see when users zooms.
+	double	fullPlaneDist = x_camera.zoom * (5280.0 / 3.2) * gPrefs.full_distance;	// Only draw planes fully within 3 miles.
+	int		maxFullPlanes = gPrefs.max_full_count;									// Draw no more than 100 full planes!
+
+	// With adaptive_lod on, scale all of these down while we are over budget.
+	LodLimits_t limits = { maxFullPlanes, fullPlaneDist, labelDist, maxDist };
+	gLodBudget.apply(limits);
+	maxFullPlanes = limits.maxFullPlanes;
+	fullPlaneDist = limits.fullPlaneDist;
+	labelDist = limits.labelDist;
+	maxDist = limits.drawDist;
+
+	if (gPlan.cycle != cycle)
+	{
+		build_render_plan(gl_camera, planeCount, maxDist, cycle);
+
+		// finally, cleanup textures.
+		RenderStageTimer timer(xpmpStage_MaintainTextures);
+		OBJ_MaintainTextures();
+	}
+	if (!gPlan.culled || !same_camera(gPlan.camera, gl_camera))
+		cull_render_plan(gl_camera, maxDist, fullPlaneDist, maxFullPlanes);
+
+	PlaneHotStore& hot = gPlanes.hot();
+
+	// PASS 0 - planes without a CSL model.  If it's time to draw austin's planes but
+	// this one doesn't have a model, we draw anything.
+	if (!is_blend && !gDrawQueue.empty(draw_NoModel))
+	{
+		RenderStageTimer timer(xpmpStage_DrawNoModel);
+		for (const DrawQueueItem_t *it = gDrawQueue.begin(draw_NoModel); it != gDrawQueue.end(draw_NoModel); ++it)
 		{
-            // figure out the multiplayer idx to use
-            int idx = iter->second.plane->multiIdx;
-            if (idx < 0 || idx >= gMultiRef.size())         // none assinged yet -> find one!
-            {
-                for (idx = 0; idx < gMultiRef.size() && gMultiRef[idx].bSlotTaken; idx++);
-            }
-            
-            if (0 <= idx && idx < gMultiRef.size()) {
-                XPLMSetDataf(gMultiRef[idx].X,      iter->second.x);
-                XPLMSetDataf(gMultiRef[idx].Y,      iter->second.y);
-                XPLMSetDataf(gMultiRef[idx].Z,      iter->second.z);
-                XPLMSetDataf(gMultiRef[idx].pitch,  iter->second.plane->pos.pitch);
-                XPLMSetDataf(gMultiRef[idx].roll,   iter->second.plane->pos.roll);
-                XPLMSetDataf(gMultiRef[idx].heading,iter->second.plane->pos.heading);
-                gMultiRef[idx].bSlotTaken = true;           // this slot taken
-                iter->second.plane->multiIdx = idx;         // save for reuse
-                if (idx > maxMultiIdxUsed)                  // remember the highest idx used
-                    maxMultiIdxUsed = idx;
-                ++renderedCounter;
-            }
+			PlaneToRender_t& plane_none = gRenderList[it->index];
+			const uint32_t row = plane_none.row;
+			push_plane_matrix(hot, row);
+
+			// Safety check - if plane 1 isn't even loaded do NOT draw, do NOT draw plane 0.
+			// Using the user's planes can cause the internal flight model to get f-cked up.
+			// Using a non-loaded plane can trigger internal asserts in x-plane.
+			if (gPlan.modelCount > 1)
+				XPLMDrawAircraft(1,
+								 hot.x[row], hot.y[row], hot.z[row],
+								 hot.pitch[row], hot.roll[row], hot.heading[row],
+								 plane_none.full ? 1 : 0, &hot.state[row]);
+
+			glPopMatrix();
 		}
 	}
-	
+
 	// PASS 1 - draw Austin's planes.
-	if(gHasControlOfAIAircraft && !is_blend)
-		for (planeMapIter = planes_austin.begin(); planeMapIter != planes_austin.end(); ++planeMapIter)
+	if(gHasControlOfAIAircraft && !is_blend && !gDrawQueue.empty(draw_Austin))
+	{
+		RenderStageTimer timer(xpmpStage_DrawAustin);
+		for (const DrawQueueItem_t *it = gDrawQueue.begin(draw_Austin); it != gDrawQueue.end(draw_Austin); ++it)
 		{
-			CSL_DrawObject(	planeMapIter->second->plane,
-							planeMapIter->second->dist,
-							planeMapIter->second->x,
-							planeMapIter->second->y,
-							planeMapIter->second->z,
-							planeMapIter->second->plane->pos.pitch,
-							planeMapIter->second->plane->pos.roll,
-							planeMapIter->second->plane->pos.heading,
+			PlaneToRender_t& plane_austin = gRenderList[it->index];
+			const uint32_t row = plane_austin.row;
+			CSL_DrawObject(	plane_austin.plane,
+							plane_austin.dist,
+							hot.x[row],
+							hot.y[row],
+							hot.z[row],
+							hot.pitch[row],
+							hot.roll[row],
+							hot.heading[row],
 							plane_Austin,
-							planeMapIter->second->full ? 1 : 0,
-							planeMapIter->second->plane->surface.lights,
-							&planeMapIter->second->state);
+							plane_austin.full ? 1 : 0,
+							hot.lights[row],
+							&hot.state[row]);
 
-			if (planeMapIter->second->full)
-				++gACFPlanes;
+			if (plane_austin.full)
+				++gRenderStats.acfPlanes;
 			else
-				++gNavPlanes;
+				++gRenderStats.navPlanes;
 		}
+	}
 	
 	// PASS 2 - draw OBJs
 	// Blend for solid OBJ7s?  YES!  First, in HDR mode, they DO NOT draw to the gbuffer properly -
@@ -720,65 +982,70 @@ void			XPMPDefaultPlaneRenderer(int is_blend)
 	//
 	// Blending isn't going to hurt things in NON-HDR because our rendering is so stupid for old objs - there's
 	// pretty much never translucency so we aren't going to get Z-order fails.  So f--- it...always draw blend.<
-	if(is_blend)
-		for (const auto &plane_obj : planes_obj)
+	// The queue has them grouped by model and textures, so state is only set per group.
+	if(is_blend && !gDrawQueue.empty(draw_Obj7))
+	{
+		RenderStageTimer timer(xpmpStage_DrawObj7);
+		OBJ_BeginModelDrawing();
+		for (const DrawQueueItem_t *it = gDrawQueue.begin(draw_Obj7); it != gDrawQueue.end(draw_Obj7); ++it)
 		{
-			CSL_DrawObject(
-						plane_obj->plane,
-						plane_obj->dist,
-						plane_obj->x,
-						plane_obj->y,
-						plane_obj->z,
-						plane_obj->plane->pos.pitch,
-						plane_obj->plane->pos.roll,
-						plane_obj->plane->pos.heading,
-						plane_Obj,
-						plane_obj->full ? 1 : 0,
-						plane_obj->plane->surface.lights,
-						&plane_obj->state);
-			++gOBJPlanes;
+			const PlaneToRender_t& plane_obj = gRenderList[it->index];
+			push_plane_matrix(hot, plane_obj.row);
+			OBJ_DrawPreparedModel(plane_obj.objPrep);
+			glPopMatrix();
+			++gRenderStats.objPlanes;
 		}
-
-	for(planeIter = planes_obj8.begin(); planeIter != planes_obj8.end(); ++planeIter)
-	{
-		CSL_DrawObject( (*planeIter)->plane,
-						(*planeIter)->dist,
-						(*planeIter)->x,
-						(*planeIter)->y,
-						(*planeIter)->z,
-						(*planeIter)->plane->pos.pitch,
-						(*planeIter)->plane->pos.roll,
-						(*planeIter)->plane->pos.heading,
-						plane_Obj8,
-						(*planeIter)->full ? 1 : 0,
-						(*planeIter)->plane->surface.lights,
-						&(*planeIter)->state);
 	}
 
+	// OBJ8s are scheduled and drawn in the solid pass only - anything scheduled in the
+	// blend pass would just be thrown away by obj_draw_done.
 	if(!is_blend)
+	{
+		RenderStageTimer timer(xpmpStage_DrawObj8);
+		for (const DrawQueueItem_t *it = gDrawQueue.begin(draw_Obj8); it != gDrawQueue.end(draw_Obj8); ++it)
+		{
+			PlaneToRender_t& plane_obj8 = gRenderList[it->index];
+			const uint32_t row = plane_obj8.row;
+			CSL_DrawObject( plane_obj8.plane,
+							plane_obj8.dist,
+							hot.x[row],
+							hot.y[row],
+							hot.z[row],
+							hot.pitch[row],
+							hot.roll[row],
+							hot.heading[row],
+							plane_Obj8,
+							plane_obj8.full ? 1 : 0,
+							hot.lights[row],
+							&hot.state[row]);
+		}
 		obj_draw_solid();
+	}
 
 	// PASS 3 - draw OBJ lights.
 
 	if(is_blend)
-		if (!planes_obj_lites.empty())
+		if (!gDrawQueue.empty(draw_Obj7Lights))
 		{
+			RenderStageTimer timer(xpmpStage_DrawLights);
 			OBJ_BeginLightDrawing();
-			for (planeIter = planes_obj_lites.begin(); planeIter != planes_obj_lites.end(); ++planeIter)
+			for (const DrawQueueItem_t *it = gDrawQueue.begin(draw_Obj7Lights); it != gDrawQueue.end(draw_Obj7Lights); ++it)
 			{
+				PlaneToRender_t& plane_lites = gRenderList[it->index];
+				const uint32_t row = plane_lites.row;
 				// this thing draws the lights of a model
-				CSL_DrawObject( (*planeIter)->plane,
-								(*planeIter)->dist,
-								(*planeIter)->x,
-								(*planeIter)->y,
-								(*planeIter)->z,
-								(*planeIter)->plane->pos.pitch,
-								(*planeIter)->plane->pos.roll,
-								(*planeIter)->plane->pos.heading,
+				CSL_DrawObject( plane_lites.plane,
+								plane_lites.dist,
+								hot.x[row],
+								hot.y[row],
+								hot.z[row],
+								hot.pitch[row],
+								hot.roll[row],
+								hot.heading[row],
 								plane_Lights,
-								(*planeIter)->full ? 1 : 0,
-								(*planeIter)->plane->surface.lights,
-								&(*planeIter)->state);
+								plane_lites.full ? 1 : 0,
+								hot.lights[row],
+								&hot.state[row]);
 			}
 		}
 	
@@ -788,6 +1055,7 @@ void			XPMPDefaultPlaneRenderer(int is_blend)
 	if(is_blend)
 		if ( gDrawLabels )
 		{
+			RenderStageTimer timer(xpmpStage_Labels);
 			double	x_scale = 1.0;
 			double	y_scale = 1.0;
             if (gHDROnRef && XPLMGetDatai(gHDROnRef)) {     // SSAA hack only if HDR enabled
@@ -827,28 +1095,57 @@ void			XPMPDefaultPlaneRenderer(int is_blend)
 				y_scale = 1.0;
 			}
 
-			for (RenderMap::iterator iter = myPlanes.begin(); iter != myPlanes.end(); ++iter)
-				if(iter->first < labelDist)
-					if(!iter->second.cull)		// IMPORTANT - airplane BEHIND us still maps XY onto screen...so we get 180 degree reflections.  But behind us acf are culled, so that's good.
+			// Gather everything that gets a label and project it to the screen in one go.
+			gLabelBuffer.clear();
+			gLabelPlanes.clear();
+			for (PlaneToRender_t& rec : gRenderList)
+				if(rec.dist < labelDist)
+					if(!rec.cull)		// IMPORTANT - airplane BEHIND us still maps XY onto screen...so we get 180 degree reflections.  But behind us acf are culled, so that's good.
 					{
-						float x, y;
-						convert_to_2d(&gl_camera, vp, iter->second.x, iter->second.y, iter->second.z, 1.0, &x, &y);
-
-                        // base color can be defined per plane
-                        // rat is between 0.0 (plane very close) and 1.0 (shortly before label cut-off):
-                        // and defines how much we move towards light gray for distance
-                        const PlaneToRender_t& ptr = iter->second;
-                        const float rat = iter->first / static_cast<float>(labelDist);
-                        constexpr float gray[4] = {0.6f, 0.6f, 0.6f, 1.0f};
-                        float c[4] = {
-                            (1.0f-rat) * ptr.plane->pos.label_color[0] + rat * gray[0],     // red
-                            (1.0f-rat) * ptr.plane->pos.label_color[1] + rat * gray[1],     // green
-                            (1.0f-rat) * ptr.plane->pos.label_color[2] + rat * gray[2],     // blue
-                            (1.0f-rat) * ptr.plane->pos.label_color[3] + rat * gray[3]      // ? (not used for text)
-                        };
-
-						XPLMDrawString(c, static_cast<int>(x / x_scale), static_cast<int>(y / y_scale)+10, (char *) iter->second.plane->pos.label, NULL, xplmFont_Basic);
+						gLabelBuffer.push_back(hot.x[rec.row], hot.y[rec.row], hot.z[rec.row]);
+						gLabelPlanes.push_back(&rec);
 					}
+			gLabelScreenX.resize(gLabelBuffer.count);
+			gLabelScreenY.resize(gLabelBuffer.count);
+			cull_project_points(gl_camera, vp, gLabelBuffer.x.data(), gLabelBuffer.y.data(), gLabelBuffer.z.data(),
+								gLabelBuffer.count, gLabelScreenX.data(), gLabelScreenY.data());
+
+			// Nearest planes claim their screen space first; a label that would overlap
+			// one placed before is dropped (unless decluttering is off).
+			gLabelOrder.resize(gLabelBuffer.count);
+			for (size_t n = 0; n < gLabelBuffer.count; ++n)
+				gLabelOrder[n] = n;
+			std::sort(gLabelOrder.begin(), gLabelOrder.end(), [](size_t a, size_t b) {
+				return gLabelPlanes[a]->dist < gLabelPlanes[b]->dist;
+			});
+			gLabelDeclutter.reset(static_cast<int>(vp[2] / x_scale), static_cast<int>(vp[3] / y_scale));
+
+			for (size_t n : gLabelOrder)
+			{
+				const PlaneToRender_t& ptr = *gLabelPlanes[n];
+				XPMPPlanePtr plane = ptr.plane;
+				label_update_layout(plane->labelLayout, plane->pos.label, plane->pos.label_color);
+
+				const int x = static_cast<int>(gLabelScreenX[n] / x_scale);
+				const int y = static_cast<int>(gLabelScreenY[n] / y_scale) + 10;
+				if (gPrefs.label_declutter &&
+					!gLabelDeclutter.place(x, y, plane->labelLayout.width, plane->labelLayout.height))
+					continue;
+
+				// base color can be defined per plane
+				// rat is between 0.0 (plane very close) and 1.0 (shortly before label cut-off):
+				// and defines how much we move towards light gray for distance
+				const float rat = ptr.dist / static_cast<float>(labelDist);
+				constexpr float gray[4] = {0.6f, 0.6f, 0.6f, 1.0f};
+				float c[4] = {
+					(1.0f-rat) * plane->labelLayout.color[0] + rat * gray[0],     // red
+					(1.0f-rat) * plane->labelLayout.color[1] + rat * gray[1],     // green
+					(1.0f-rat) * plane->labelLayout.color[2] + rat * gray[2],     // blue
+					(1.0f-rat) * plane->labelLayout.color[3] + rat * gray[3]      // ? (not used for text)
+				};
+
+				XPLMDrawString(c, x, y, plane->labelLayout.text, NULL, xplmFont_Basic);
+			}
 
 			glMatrixMode(GL_PROJECTION);
 			glPopMatrix();
@@ -856,30 +1153,6 @@ void			XPMPDefaultPlaneRenderer(int is_blend)
 			glPopMatrix();
 
 		}
-
-	
-	// Final hack - leave a note to ourselves for how many of Austin's planes we relocated to do TCAS.
-	gEnableCount = (maxMultiIdxUsed+1);
-    // As some plugins don't consider XPLMCountAircraft let's cleanup unused multiplayer datarefs
-    if (gHasControlOfAIAircraft) {
-        for (multiDataRefsTy& mdr : gMultiRef)
-        {
-            // if not used reset all values
-            if (!mdr.bSlotTaken) {
-                XPLMSetDataf(mdr.X, FAR_AWAY_VAL_GL);
-                XPLMSetDataf(mdr.Y, FAR_AWAY_VAL_GL);
-                XPLMSetDataf(mdr.Z, FAR_AWAY_VAL_GL);
-                XPLMSetDataf(mdr.pitch, 0.0f);
-                XPLMSetDataf(mdr.roll, 0.0f);
-                XPLMSetDataf(mdr.heading, 0.0f);
-            }
-        }
-    }
-	
-	gDumpOneRenderCycle = 0;
-
-	// finally, cleanup textures.
-	OBJ_MaintainTextures();
 }
 
 void XPMPEnableAircraftLabels()
@@ -897,3 +1170,40 @@ bool XPMPDrawingAircraftLabels()
 	return gDrawLabels;
 }
 
+void XPMPInvalidateTerrainCache()
+{
+	gTerrainCache.invalidate();
+}
+
+void XPMPGetTerrainCacheStats(long * outPlaneHits, long * outCellHits, long * outMisses, long * outDeferred)
+{
+	if (outPlaneHits)	*outPlaneHits = gTerrainCache.planeHits();
+	if (outCellHits)	*outCellHits = gTerrainCache.cellHits();
+	if (outMisses)		*outMisses = gTerrainCache.misses();
+	if (outDeferred)	*outDeferred = gTerrainCache.deferred();
+}
+
+int XPMPGetTcasSlotCount()
+{
+	return gTcasSlots.size();
+}
+
+XPMPPlaneID XPMPGetPlaneInTcasSlot(int inSlot)
+{
+	if (inSlot < 0 || inSlot >= gTcasSlots.size())
+		return NULL;
+	XPMPPlanePtr plane = gTcasSlots.owner(inSlot);
+	return plane ? plane->id : NULL;
+}
+
+int XPMPGetTcasSlotOfPlane(XPMPPlaneID inPlane)
+{
+	XPMPPlanePtr plane = gPlanes.find(inPlane);
+	return plane ? gPlanes.hot().multiIdx[gPlanes.indexOf(plane)] : -1;
+}
+
+void XPMPGetRenderStats(XPMPRenderStats_t * outStats)
+{
+	if (outStats)
+		gRenderStats.get(*outStats);
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "XPMPRenderStats.h"
+
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+RenderStats gRenderStats;
+
+static const char * kStageNames[xpmpStage_Count] = {
+	"data_pull",
+	"world_to_local",
+	"cull",
+	"vert_offset",
+	"terrain_probe",
+	"tcas",
+	"draw_nomodel",
+	"draw_austin",
+	"draw_obj7",
+	"draw_obj8",
+	"draw_lights",
+	"labels",
+	"maintain_textures",
+	"total"
+};
+
+static const char * kStatSuffix[3] = { "_min_us", "_mean_us", "_p99_us" };
+
+static const char * kCounterNames[4] = { "planes", "acf_planes", "nav_planes", "obj_planes" };
+
+void RenderStats::init()
+{
+	if (!mDataRefs.empty())
+		return;
+	mSummary.size = sizeof(mSummary);
+
+	for (int stage = 0; stage < xpmpStage_Count; ++stage)
+		for (int kind = 0; kind < 3; ++kind)
+		{
+			std::string name = std::string("libxplanemp/stats/") + kStageNames[stage] + kStatSuffix[kind];
+			mDataRefs.push_back(XPLMRegisterDataAccessor(name.c_str(), xplmType_Float, 0,
+								NULL, NULL, getStat, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+								reinterpret_cast<void *>(intptr_t(stage * 3 + kind)), NULL));
+		}
+	for (int n = 0; n < 4; ++n)
+	{
+		std::string name = std::string("libxplanemp/stats/") + kCounterNames[n];
+		mDataRefs.push_back(XPLMRegisterDataAccessor(name.c_str(), xplmType_Int, 0,
+							getCounter, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+							reinterpret_cast<void *>(intptr_t(n)), NULL));
+	}
+}
+
+void RenderStats::deinit()
+{
+	for (XPLMDataRef ref : mDataRefs)
+		XPLMUnregisterDataAccessor(ref);
+	mDataRefs.clear();
+}
+
+void RenderStats::endFrame()
+{
+	for (int stage = 0; stage < xpmpStage_Count; ++stage)
+	{
+		mRing[stage][mRingPos] = static_cast<float>(mFrame[stage]);
+		mFrame[stage] = 0.0;
+	}
+	mRingPos = (mRingPos + 1) % kWindow;
+	if (mRingCount < kWindow)
+		++mRingCount;
+
+	// Summaries are made here, once a frame, so reading the datarefs is free.
+	const int last = (mRingPos + kWindow - 1) % kWindow;
+	const int p99 = std::max(0, (mRingCount * 99 + 99) / 100 - 1);
+	float sorted[kWindow];
+	for (int stage = 0; stage < xpmpStage_Count; ++stage)
+	{
+		XPMPRenderStageStats_t& s = mSummary.stages[stage];
+		double sum = 0.0;
+		for (int i = 0; i < mRingCount; ++i)
+		{
+			sorted[i] = mRing[stage][i];
+			sum += sorted[i];
+		}
+		std::nth_element(sorted, sorted + p99, sorted + mRingCount);
+		s.p99Us = sorted[p99];
+		s.minUs = *std::min_element(sorted, sorted + mRingCount);
+		s.meanUs = static_cast<float>(sum / mRingCount);
+		s.lastUs = mRing[stage][last];
+	}
+	mSummary.frames = mRingCount;
+	mSummary.planes = planes;
+	mSummary.acfPlanes = acfPlanes;
+	mSummary.navPlanes = navPlanes;
+	mSummary.objPlanes = objPlanes;
+	mSummary.lodLevel = lodLevel;
+
+	// counted while drawing - a plan rebuilt mid-frame must not start them over
+	acfPlanes = navPlanes = objPlanes = 0;
+}
+
+void RenderStats::get(XPMPRenderStats_t &outStats) const
+{
+	long size = outStats.size;
+	if (size <= 0 || size > static_cast<long>(sizeof(mSummary)))
+		size = sizeof(mSummary);
+	memcpy(&outStats, &mSummary, size);
+	outStats.size = size;
+}
+
+float RenderStats::getStat(void * inRefcon)
+{
+	const int n = static_cast<int>(reinterpret_cast<intptr_t>(inRefcon));
+	const XPMPRenderStageStats_t& s = gRenderStats.mSummary.stages[n / 3];
+	switch (n % 3) {
+	case 0:		return s.minUs;
+	case 1:		return s.meanUs;
+	default:	return s.p99Us;
+	}
+}
+
+int RenderStats::getCounter(void * inRefcon)
+{
+	switch (reinterpret_cast<intptr_t>(inRefcon)) {
+	case 0:		return gRenderStats.mSummary.planes;
+	case 1:		return gRenderStats.mSummary.acfPlanes;
+	case 2:		return gRenderStats.mSummary.navPlanes;
+	default:	return gRenderStats.mSummary.objPlanes;
+	}
+}
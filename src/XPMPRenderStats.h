@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef XPMPRENDERSTATS_H
+#define XPMPRENDERSTATS_H
+
+/*
+ * XPMPRenderStats
+ *
+ * Cheap always-on timing of the default renderer's stages.  A RenderStageTimer on the
+ * stack adds its lifetime to the stage; a stage can be entered any number of times a
+ * frame (e.g. once per drawing pass).  endFrame() moves the frame's totals into a
+ * ring of the last kWindow frames, from which min, mean and 99th percentile come.
+ *
+ */
+
+#include "XPMPMultiplayer.h"
+#include "XPLMDataAccess.h"
+
+#include <chrono>
+#include <vector>
+
+class RenderStats {
+
+public:
+	static const int kWindow = 128;		// frames
+
+	void init();		// registers the libxplanemp/stats datarefs
+	void deinit();
+
+	void add(int inStage, double inMicroseconds)	{ mFrame[inStage] += inMicroseconds; }
+	void endFrame();
+
+	void get(XPMPRenderStats_t &outStats) const;
+
+	// plane counters of the current frame - endFrame() resets the drawn ones
+	int			planes = 0;
+	int			acfPlanes = 0;
+	int			navPlanes = 0;
+	int			objPlanes = 0;
+	float		lodLevel = 1.0f;
+
+	// total renderer time of the last complete frame
+	float lastFrameUs() const			{ return mSummary.stages[xpmpStage_Total].lastUs; }
+	// ...less the data pull, which is mostly the clients' callbacks and not ours to save
+	float lastFrameRenderUs() const
+	{
+		const float us = mSummary.stages[xpmpStage_Total].lastUs - mSummary.stages[xpmpStage_DataPull].lastUs;
+		return us > 0.0f ? us : 0.0f;
+	}
+
+private:
+	static float	getStat(void * inRefcon);
+	static int		getCounter(void * inRefcon);
+
+	double					mFrame[xpmpStage_Count] = {};		// this frame so far
+	float					mRing[xpmpStage_Count][kWindow] = {};
+	int						mRingPos = 0;
+	int						mRingCount = 0;
+	XPMPRenderStats_t		mSummary = {};						// as of the last endFrame
+	std::vector<XPLMDataRef>	mDataRefs;
+};
+
+extern RenderStats gRenderStats;
+
+class RenderStageTimer {
+
+public:
+	explicit RenderStageTimer(int inStage) :
+		mStage(inStage), mStart(std::chrono::steady_clock::now()) { }
+	~RenderStageTimer()
+	{
+		std::chrono::duration<double, std::micro> d = std::chrono::steady_clock::now() - mStart;
+		gRenderStats.add(mStage, d.count());
+	}
+
+private:
+	int										mStage;
+	std::chrono::steady_clock::time_point	mStart;
+};
+
+#endif /* XPMPRENDERSTATS_H */
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "XPMPSnapshots.h"
+#include "Interpolation.h"
+
+#include <math.h>
+
+static const double kDegToRad = 3.14159265358979323846 / 180.0;
+
+struct Quat_t { double w, x, y, z; };
+
+// heading (yaw), pitch, roll in degrees - the usual aerospace Z-Y-X order
+static Quat_t quat_from_euler(double inHeading, double inPitch, double inRoll)
+{
+	double cy = cos(inHeading * kDegToRad * 0.5), sy = sin(inHeading * kDegToRad * 0.5);
+	double cp = cos(inPitch * kDegToRad * 0.5), sp = sin(inPitch * kDegToRad * 0.5);
+	double cr = cos(inRoll * kDegToRad * 0.5), sr = sin(inRoll * kDegToRad * 0.5);
+	Quat_t q;
+	q.w = cr * cp * cy + sr * sp * sy;
+	q.x = sr * cp * cy - cr * sp * sy;
+	q.y = cr * sp * cy + sr * cp * sy;
+	q.z = cr * cp * sy - sr * sp * cy;
+	return q;
+}
+
+static void quat_to_euler(const Quat_t &q, float &outHeading, float &outPitch, float &outRoll)
+{
+	double roll = atan2(2.0 * (q.w * q.x + q.y * q.z), 1.0 - 2.0 * (q.x * q.x + q.y * q.y));
+	double pitch = asin(clamp(2.0 * (q.w * q.y - q.z * q.x), -1.0, 1.0));
+	double heading = atan2(2.0 * (q.w * q.z + q.x * q.y), 1.0 - 2.0 * (q.y * q.y + q.z * q.z));
+	heading /= kDegToRad;
+	if (heading < 0.0)
+		heading += 360.0;
+	outHeading = static_cast<float>(heading);
+	outPitch = static_cast<float>(pitch / kDegToRad);
+	outRoll = static_cast<float>(roll / kDegToRad);
+}
+
+static Quat_t quat_slerp(Quat_t a, const Quat_t &b, double t)
+{
+	double d = a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
+	if (d < 0.0)		// take the short way round
+	{
+		a.w = -a.w; a.x = -a.x; a.y = -a.y; a.z = -a.z;
+		d = -d;
+	}
+	double ka, kb;
+	if (d > 0.9995)		// nearly the same - plain lerp is fine and stable
+	{
+		ka = 1.0 - t;
+		kb = t;
+	}
+	else
+	{
+		double th = acos(d);
+		double s = sin(th);
+		ka = sin((1.0 - t) * th) / s;
+		kb = sin(t * th) / s;
+	}
+	Quat_t q = { ka * a.w + kb * b.w, ka * a.x + kb * b.x, ka * a.y + kb * b.y, ka * a.z + kb * b.z };
+	double n = sqrt(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+	q.w /= n; q.x /= n; q.y /= n; q.z /= n;
+	return q;
+}
+
+// longitude of inLon as close as possible to inRef, so we never interpolate the long
+// way round across the date line
+static double unwrap_lon(double inLon, double inRef)
+{
+	while (inLon - inRef > 180.0) inLon -= 360.0;
+	while (inLon - inRef < -180.0) inLon += 360.0;
+	return inLon;
+}
+
+static double wrap_lon(double inLon)
+{
+	while (inLon > 180.0) inLon -= 360.0;
+	while (inLon < -180.0) inLon += 360.0;
+	return inLon;
+}
+
+static void set_state(XPMPPlanePosition_t &ioPos, const XPMPPlaneSnapshot_t &inSnap)
+{
+	ioPos.lat = inSnap.lat;
+	ioPos.lon = inSnap.lon;
+	ioPos.elevation = inSnap.elevation;
+	ioPos.pitch = inSnap.pitch;
+	ioPos.roll = inSnap.roll;
+	ioPos.heading = inSnap.heading;
+}
+
+void PlaneSnapshotBuffer::push(const XPMPPlaneSnapshot_t &inSnap)
+{
+	if (mCount > 0)
+	{
+		XPMPPlaneSnapshot_t &newest = mSnaps[(mFirst + mCount - 1) % kCapacity];
+		if (inSnap.time < newest.time)
+			return;
+		if (inSnap.time == newest.time)
+		{
+			newest = inSnap;
+			return;
+		}
+	}
+	if (mCount == kCapacity)
+	{
+		mFirst = (mFirst + 1) % kCapacity;
+		--mCount;
+	}
+	mSnaps[(mFirst + mCount) % kCapacity] = inSnap;
+	++mCount;
+}
+
+void PlaneSnapshotBuffer::evaluate(double inTime, double inMaxExtrapolation, XPMPPlanePosition_t &ioPos) const
+{
+	if (mCount == 0)
+		return;
+
+	const XPMPPlaneSnapshot_t &first = at(0);
+	const XPMPPlaneSnapshot_t &last = at(mCount - 1);
+
+	if (mCount == 1 || inTime <= first.time)
+	{
+		set_state(ioPos, inTime <= first.time ? first : last);
+		return;
+	}
+
+	if (inTime >= last.time)
+	{
+		// Dead reckoning: keep going with the velocity between the last two snapshots,
+		// but not forever - a feed that stopped shouldn't send planes across the map.
+		const XPMPPlaneSnapshot_t &prev = at(mCount - 2);
+		double dt = last.time - prev.time;
+		double ahead = inTime - last.time;
+		if (ahead > inMaxExtrapolation)
+			ahead = inMaxExtrapolation;
+		set_state(ioPos, last);
+		if (dt > 0.0 && ahead > 0.0)
+		{
+			double k = ahead / dt;
+			ioPos.lat = last.lat + (last.lat - prev.lat) * k;
+			ioPos.lon = wrap_lon(last.lon + (last.lon - unwrap_lon(prev.lon, last.lon)) * k);
+			ioPos.elevation = last.elevation + (last.elevation - prev.elevation) * k;
+		}
+		return;
+	}
+
+	// find the snapshots i, i+1 around inTime
+	int i = 0;
+	while (i + 2 < mCount && at(i + 1).time <= inTime)
+		++i;
+	const XPMPPlaneSnapshot_t &s1 = at(i);
+	const XPMPPlaneSnapshot_t &s2 = at(i + 1);
+	// outside neighbours - at the ends of the ring we mirror the segment
+	const XPMPPlaneSnapshot_t &s0 = at(i > 0 ? i - 1 : i);
+	const XPMPPlaneSnapshot_t &s3 = at(i + 2 < mCount ? i + 2 : i + 1);
+
+	const double t0 = (&s0 != &s1) ? s0.time : s1.time - (s2.time - s1.time);
+	const double t3 = (&s3 != &s2) ? s3.time : s2.time + (s2.time - s1.time);
+	const double v0lat = (&s0 != &s1) ? s0.lat : 2.0 * s1.lat - s2.lat;
+	const double v3lat = (&s3 != &s2) ? s3.lat : 2.0 * s2.lat - s1.lat;
+	const double lon1 = s1.lon;
+	const double lon2 = unwrap_lon(s2.lon, lon1);
+	const double v0lon = (&s0 != &s1) ? unwrap_lon(s0.lon, lon1) : 2.0 * lon1 - lon2;
+	const double v3lon = (&s3 != &s2) ? unwrap_lon(s3.lon, lon2) : 2.0 * lon2 - lon1;
+	const double v0ele = (&s0 != &s1) ? s0.elevation : 2.0 * s1.elevation - s2.elevation;
+	const double v3ele = (&s3 != &s2) ? s3.elevation : 2.0 * s2.elevation - s1.elevation;
+
+	ioPos.lat = HermiteInterpolate1d(v0lat, s1.lat, s2.lat, v3lat, t0, s1.time, s2.time, t3, inTime);
+	ioPos.lon = wrap_lon(HermiteInterpolate1d(v0lon, lon1, lon2, v3lon, t0, s1.time, s2.time, t3, inTime));
+	ioPos.elevation = HermiteInterpolate1d(v0ele, s1.elevation, s2.elevation, v3ele, t0, s1.time, s2.time, t3, inTime);
+
+	const double f = (inTime - s1.time) / (s2.time - s1.time);
+	Quat_t q = quat_slerp(quat_from_euler(s1.heading, s1.pitch, s1.roll),
+						  quat_from_euler(s2.heading, s2.pitch, s2.roll), f);
+	quat_to_euler(q, ioPos.heading, ioPos.pitch, ioPos.roll);
+}
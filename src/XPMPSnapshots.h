@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef XPMPSNAPSHOTS_H
+#define XPMPSNAPSHOTS_H
+
+/*
+ * XPMPSnapshots
+ *
+ * A small ring of timestamped position/attitude snapshots per plane, fed through
+ * XPMPPushPlaneSnapshots.  Once per frame the renderer asks for the state at "now minus
+ * a small delay": between snapshots position is a cubic Hermite curve through the
+ * neighbouring samples and attitude is slerped; after the newest snapshot we dead-reckon
+ * with the last velocity for a limited time and then hold.
+ *
+ */
+
+#include "XPMPMultiplayer.h"
+
+class PlaneSnapshotBuffer {
+
+public:
+	static const int kCapacity = 8;
+
+	bool empty() const				{ return mCount == 0; }
+
+	// Snapshots must come in time order; one older than the newest we have is dropped,
+	// one with the same time replaces it.
+	void push(const XPMPPlaneSnapshot_t &inSnap);
+
+	// State at inTime, extrapolating no more than inMaxExtrapolation seconds past the
+	// newest snapshot.  Only lat/lon/elevation and attitude of ioPos are written.
+	void evaluate(double inTime, double inMaxExtrapolation, XPMPPlanePosition_t &ioPos) const;
+
+private:
+	const XPMPPlaneSnapshot_t &at(int i) const	{ return mSnaps[(mFirst + i) % kCapacity]; }
+
+	XPMPPlaneSnapshot_t		mSnaps[kCapacity];
+	int						mFirst = 0;
+	int						mCount = 0;
+};
+
+#endif /* XPMPSNAPSHOTS_H */
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "XPMPTcasSlots.h"
+
+#if IBM
+#include <intrin.h>
+#endif
+
+TcasSlotAllocator gTcasSlots;
+
+static inline int lowest_bit(uint64_t inBits)
+{
+#if IBM
+	unsigned long idx;
+	_BitScanForward64(&idx, inBits);
+	return (int)idx;
+#else
+	return __builtin_ctzll(inBits);
+#endif
+}
+
+static inline int highest_bit(uint64_t inBits)
+{
+#if IBM
+	unsigned long idx;
+	_BitScanReverse64(&idx, inBits);
+	return (int)idx;
+#else
+	return 63 - __builtin_clzll(inBits);
+#endif
+}
+
+void TcasSlotAllocator::reset(int inSlots)
+{
+	mOwner.assign(inSlots, nullptr);
+	mFree.assign((inSlots + 63) / 64, ~uint64_t(0));
+	// no bits for slots that don't exist
+	if (inSlots % 64)
+		mFree.back() = (uint64_t(1) << (inSlots % 64)) - 1;
+}
+
+int TcasSlotAllocator::used() const
+{
+	for (size_t w = mFree.size(); w-- > 0; )
+	{
+		uint64_t valid = (w + 1) * 64 <= mOwner.size() ? ~uint64_t(0) :
+						 (uint64_t(1) << (mOwner.size() % 64)) - 1;
+		uint64_t taken = ~mFree[w] & valid;
+		if (taken)
+			return int(w * 64) + highest_bit(taken) + 1;
+	}
+	return 0;
+}
+
+int TcasSlotAllocator::acquire(XPMPPlane_t * inPlane)
+{
+	for (size_t w = 0; w < mFree.size(); ++w)
+	{
+		if (!mFree[w])
+			continue;
+		int slot = int(w * 64) + lowest_bit(mFree[w]);
+		mFree[w] &= ~(uint64_t(1) << (slot % 64));
+		mOwner[slot] = inPlane;
+		return slot;
+	}
+	return -1;
+}
+
+void TcasSlotAllocator::release(int inSlot)
+{
+	if (inSlot < 0 || inSlot >= (int)mOwner.size() || !mOwner[inSlot])
+		return;
+	mOwner[inSlot] = nullptr;
+	mFree[inSlot / 64] |= uint64_t(1) << (inSlot % 64);
+}
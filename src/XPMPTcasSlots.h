@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef XPMPTCASSLOTS_H
+#define XPMPTCASSLOTS_H
+
+/*
+ * XPMPTcasSlots
+ *
+ * Hands out the sim/multiplayer/position/planeN slots we use to show our planes on
+ * TCAS.  Free slots are kept in a bitmask, so taking the lowest free slot, releasing
+ * one and looking up a slot's owner are all O(1).  The lowest free slot is always
+ * handed out first so that the slots in use stay packed at the low end (gEnableCount
+ * tells X-Plane how many of them to look at).
+ *
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+struct XPMPPlane_t;
+
+class TcasSlotAllocator {
+
+public:
+	// Sets the number of slots; all slots are free afterwards.
+	void reset(int inSlots);
+
+	int size() const						{ return (int)mOwner.size(); }
+	bool taken(int inSlot) const			{ return mOwner[inSlot] != nullptr; }
+	XPMPPlane_t * owner(int inSlot) const	{ return mOwner[inSlot]; }
+	// One past the highest slot in use, 0 if none.
+	int used() const;
+
+	// Takes the lowest free slot for the plane, -1 if all are taken.
+	int acquire(XPMPPlane_t * inPlane);
+	void release(int inSlot);
+
+private:
+	std::vector<XPMPPlane_t *>	mOwner;		// per slot, nullptr = free
+	std::vector<uint64_t>		mFree;		// bit set = slot free
+};
+
+extern TcasSlotAllocator gTcasSlots;
+
+#endif /* XPMPTCASSLOTS_H */
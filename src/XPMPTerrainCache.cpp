@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "XPMPTerrainCache.h"
+
+#include <math.h>
+
+TerrainHeightCache gTerrainCache;
+
+// We don't let the cell map grow forever - a long flight would otherwise
+// collect every cell it ever saw.
+static const size_t kMaxCells = 65536;
+
+void TerrainHeightCache::init()
+{
+	if (!mProbe)
+		mProbe = XPLMCreateProbe(xplm_ProbeY);
+	mLatRef = XPLMFindDataRef("sim/flightmodel/position/lat_ref");
+	mLonRef = XPLMFindDataRef("sim/flightmodel/position/lon_ref");
+	invalidate();
+}
+
+void TerrainHeightCache::deinit()
+{
+	if (mProbe)
+		XPLMDestroyProbe(mProbe);
+	mProbe = nullptr;
+	mCells.clear();
+}
+
+void TerrainHeightCache::beginFrame()
+{
+	mProbesThisFrame = 0;
+
+	// When X-Plane moves the origin of the local coordinate system every local
+	// coordinate we know of is wrong.
+	if (mLatRef && mLonRef)
+	{
+		float lat = XPLMGetDataf(mLatRef);
+		float lon = XPLMGetDataf(mLonRef);
+		if (lat != mLastLatRef || lon != mLastLonRef)
+		{
+			mLastLatRef = lat;
+			mLastLonRef = lon;
+			invalidate();
+		}
+	}
+}
+
+void TerrainHeightCache::invalidate()
+{
+	mCells.clear();
+	// generation 0 is reserved for "never probed"
+	if (++mGeneration == 0)
+		mGeneration = 1;
+}
+
+void TerrainHeightCache::setCellSize(float inMeters)
+{
+	if (inMeters < 0.1f)
+		inMeters = 0.1f;
+	if (inMeters != mCellSize)
+	{
+		mCellSize = inMeters;
+		invalidate();
+	}
+}
+
+uint64_t TerrainHeightCache::cellKey(float inX, float inZ) const
+{
+	int32_t cx = static_cast<int32_t>(floorf(inX / mCellSize));
+	int32_t cz = static_cast<int32_t>(floorf(inZ / mCellSize));
+	return (static_cast<uint64_t>(static_cast<uint32_t>(cx)) << 32) | static_cast<uint32_t>(cz);
+}
+
+bool TerrainHeightCache::terrainHeight(float inX, float inY, float inZ, TerrainProbeMemo &ioMemo, float &outTerrainY)
+{
+	const bool memoValid = (ioMemo.generation == mGeneration);
+
+	// Did the plane hardly move since it was last probed?
+	if (memoValid &&
+		fabsf(inX - ioMemo.x) < mMotionThreshold &&
+		fabsf(inZ - ioMemo.z) < mMotionThreshold)
+	{
+		++mPlaneHits;
+		outTerrainY = ioMemo.terrainY;
+		return true;
+	}
+
+	// Did anyone probe this cell already?
+	const uint64_t key = cellKey(inX, inZ);
+	auto cell = mCells.find(key);
+	if (cell != mCells.end())
+	{
+		++mCellHits;
+		ioMemo.x = inX;
+		ioMemo.z = inZ;
+		ioMemo.terrainY = cell->second;
+		ioMemo.terrainBelow = inY - cell->second;
+		ioMemo.generation = mGeneration;
+		outTerrainY = cell->second;
+		return true;
+	}
+
+	// Out of probes for this frame?  Then the plane's last height will have to do.
+	if (mMaxProbesPerFrame >= 0 && mProbesThisFrame >= mMaxProbesPerFrame)
+	{
+		++mDeferred;
+		if (memoValid)
+			outTerrainY = ioMemo.terrainY;
+		else if (ioMemo.generation != 0)
+			// origin shift or scenery reload - the old height is in the old coordinates
+			outTerrainY = inY - ioMemo.terrainBelow;
+		else
+			return false;
+		return true;
+	}
+
+	++mMisses;
+	++mProbesThisFrame;
+	XPLMProbeInfo_t info;
+	info.structSize = sizeof(XPLMProbeInfo_t);
+	XPLMProbeResult res = XPLMProbeTerrainXYZ(mProbe, inX, inY, inZ, &info);
+	if (res != xplm_ProbeHitTerrain)
+		return false;
+
+	if (mCells.size() >= kMaxCells)
+		mCells.clear();
+	mCells[key] = info.locationY;
+	ioMemo.x = inX;
+	ioMemo.z = inZ;
+	ioMemo.terrainY = info.locationY;
+	ioMemo.terrainBelow = inY - info.locationY;
+	ioMemo.generation = mGeneration;
+	outTerrainY = info.locationY;
+	return true;
+}
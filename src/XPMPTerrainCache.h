@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2005, Ben Supnik and Chris Serio.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifndef XPMPTERRAINCACHE_H
+#define XPMPTERRAINCACHE_H
+
+/*
+ * XPMPTerrainCache
+ *
+ * Ground clamping needs the terrain height under every clamped plane, every frame.
+ * XPLMProbeTerrainXYZ isn't cheap, and at a busy airport most of those planes are
+ * standing still or crawling along a taxiway.  This cache keeps terrain heights in
+ * quantized cells of the local XZ plane, remembers the last probe per plane, and
+ * caps the number of fresh probes per frame.  Everything is dropped when X-Plane
+ * shifts the local coordinate origin or when the client tells us scenery reloaded.
+ *
+ */
+
+#include "XPLMScenery.h"
+#include "XPLMDataAccess.h"
+
+#include <stdint.h>
+#include <unordered_map>
+
+// The last terrain height found for one plane - lives in XPMPPlane_t.
+struct TerrainProbeMemo {
+	float		x = 0.0f;				// local coordinates the height is valid for
+	float		z = 0.0f;
+	float		terrainY = 0.0f;
+	float		terrainBelow = 0.0f;	// how far below the plane it was - survives an invalidate
+	unsigned	generation = 0;			// cache generation, 0 = never probed
+};
+
+class TerrainHeightCache {
+
+public:
+	void init();
+	void deinit();
+
+	// Call once per frame before the first lookup: checks for a shifted local origin
+	// and resets the probe budget.
+	void beginFrame();
+	// Drop everything, e.g. after scenery was (re)loaded.
+	void invalidate();
+
+	// Terrain height below x/y/z.  Returns false if we don't know it (no terrain, or
+	// we ran out of probes this frame and never had anything for this plane).  If we ran
+	// out of probes after an invalidate, the plane is taken to be as far above the
+	// ground as at its last probe, so ground planes don't pop up for a frame.
+	bool terrainHeight(float inX, float inY, float inZ, TerrainProbeMemo &ioMemo, float &outTerrainY);
+
+	void setCellSize(float inMeters);
+	void setMotionThreshold(float inMeters)		{ mMotionThreshold = inMeters; }
+	void setMaxProbesPerFrame(int inProbes)		{ mMaxProbesPerFrame = inProbes; }
+
+	// Statistics since the last reset
+	long planeHits() const		{ return mPlaneHits; }		// plane hardly moved, reused its own last result
+	long cellHits() const		{ return mCellHits; }		// another probe in the same cell
+	long misses() const			{ return mMisses; }			// real probes
+	long deferred() const		{ return mDeferred; }		// wanted a probe but hit the per-frame cap
+	void resetStats()			{ mPlaneHits = mCellHits = mMisses = mDeferred = 0; }
+
+private:
+	uint64_t cellKey(float inX, float inZ) const;
+
+	XPLMProbeRef		mProbe = nullptr;
+	XPLMDataRef			mLatRef = nullptr;
+	XPLMDataRef			mLonRef = nullptr;
+	float				mLastLatRef = 0.0f;
+	float				mLastLonRef = 0.0f;
+
+	std::unordered_map<uint64_t, float> mCells;
+	unsigned			mGeneration = 1;
+	float				mCellSize = 4.0f;
+	float				mMotionThreshold = 0.5f;
+	int					mMaxProbesPerFrame = 64;
+	int					mProbesThisFrame = 0;
+
+	long				mPlaneHits = 0;
+	long				mCellHits = 0;
+	long				mMisses = 0;
+	long				mDeferred = 0;
+};
+
+extern TerrainHeightCache gTerrainCache;
+
+#endif /* XPMPTERRAINCACHE_H */